@@ -0,0 +1,491 @@
+// SPDX-License-Identifier: MIT
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#endif
+
+#include <libvcdparser.h>
+#include <tokenizer.h>
+
+#include "vcd_generator.h"
+
+// every allocation of the process is counted, the parser's as well as the benchmark's own
+static std::atomic<uint64_t> allocationCount(0);
+static std::atomic<uint64_t> allocationBytes(0);
+
+void *operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+    struct Result {
+        double seconds = 0;
+        uint64_t count = 0;
+        uint64_t allocations = 0;
+        uint64_t allocatedBytes = 0;
+        uint64_t arenaBytes = 0;
+        long peakRssKb = 0;
+    };
+
+    // returns the number of tokens for the tokenizer benchmarks, and fills in arenaBytes where there is an arena
+    typedef std::function<uint64_t(const std::string &input, uint64_t &arenaBytes)> Benchmark;
+
+    struct NamedBenchmark {
+        std::string name;
+        Benchmark run;
+    };
+
+    Result measure(const std::string &input, const Benchmark &benchmark) {
+        Result result;
+        uint64_t count = allocationCount.load();
+        uint64_t bytes = allocationBytes.load();
+        auto start = std::chrono::steady_clock::now();
+        result.count = benchmark(input, result.arenaBytes);
+        auto stop = std::chrono::steady_clock::now();
+        result.seconds = std::chrono::duration<double>(stop - start).count();
+        result.allocations = allocationCount.load() - count;
+        result.allocatedBytes = allocationBytes.load() - bytes;
+        return result;
+    }
+
+    /**
+     * Runs the benchmark in a child process, so the peak RSS belongs to this benchmark alone.
+     */
+    Result measureIsolated(const std::string &input, const Benchmark &benchmark) {
+#ifdef _WIN32
+        return measure(input, benchmark);
+#else
+        int fds[2];
+        if (pipe(fds) != 0) {
+            throw std::runtime_error("Can't create a pipe");
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("Can't fork");
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            Result result = measure(input, benchmark);
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            result.peakRssKb = usage.ru_maxrss;
+            ssize_t written = write(fds[1], &result, sizeof(result));
+            _exit(written == sizeof(result) ? 0 : 1);
+        }
+        close(fds[1]);
+        Result result;
+        ssize_t received = read(fds[0], &result, sizeof(result));
+        close(fds[0]);
+        int status;
+        waitpid(pid, &status, 0);
+        if (received != sizeof(result) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            throw std::runtime_error("Benchmark process failed");
+        }
+        return result;
+#endif
+    }
+
+    uint64_t parseFile(const std::string &input, uint64_t &arenaBytes, VcdFormat::StorageMode mode,
+                       unsigned int threads) {
+        VcdParser::VcdParser parser(input);
+        parser.setStorageMode(mode);
+        parser.setThreadCount(threads);
+        parser.parse();
+        VcdFormat::VcdFile &file = parser.getResult();
+        arenaBytes = file.arena->getAllocatedBytes();
+        return file.variableList.size();
+    }
+
+    class CountingHandler : public VcdParser::VcdHandler {
+    public:
+        uint64_t changes = 0;
+
+        void onScalarChange(uint32_t /*id*/, char /*value*/) override {
+            changes++;
+        }
+
+        void onVectorChange(uint32_t /*id*/, const VcdParser::TokenView &/*value*/) override {
+            changes++;
+        }
+
+        void onRealChange(uint32_t /*id*/, double /*value*/) override {
+            changes++;
+        }
+    };
+
+    const char *getLevelName(VcdParser::Simd::Level level) {
+        switch (level) {
+            case VcdParser::Simd::Level::SSE2:
+                return "sse2";
+            case VcdParser::Simd::Level::AVX2:
+                return "avx2";
+            default:
+                return "scalar";
+        }
+    }
+
+    std::vector<NamedBenchmark> getBenchmarks() {
+        std::vector<NamedBenchmark> benchmarks;
+        benchmarks.push_back({"tokenizer/string", [](const std::string &input, uint64_t &) {
+            VcdParser::Tokenizer tokenizer(input.data(), input.size());
+            uint64_t tokens = 0;
+            while (!tokenizer.getNextToken().empty()) {
+                tokens++;
+            }
+            return tokens;
+        }});
+        VcdParser::Simd::Level levels[] = {VcdParser::Simd::Level::Scalar, VcdParser::Simd::Level::SSE2,
+                                           VcdParser::Simd::Level::AVX2};
+        for (VcdParser::Simd::Level level : levels) {
+            if (VcdParser::Simd::clampLevel(level) != level) {
+                continue;
+            }
+            benchmarks.push_back({std::string("tokenizer/view-") + getLevelName(level),
+                                  [level](const std::string &input, uint64_t &) {
+                                      VcdParser::Tokenizer tokenizer(input.data(), input.size());
+                                      tokenizer.setSimdLevel(level);
+                                      uint64_t tokens = 0;
+                                      while (!tokenizer.getNextTokenView().empty()) {
+                                          tokens++;
+                                      }
+                                      return tokens;
+                                  }});
+        }
+        for (VcdParser::Simd::Level level : levels) {
+            if (VcdParser::Simd::clampLevel(level) != level) {
+                continue;
+            }
+            // validating and packing the vector values, the per-character work of parse/packed
+            benchmarks.push_back({std::string("values/pack-") + getLevelName(level),
+                                  [level](const std::string &input, uint64_t &) {
+                                      VcdParser::Simd::FindInvalidValueFunction findInvalidValue =
+                                              VcdParser::Simd::getFindInvalidValue(level);
+                                      VcdParser::Simd::PackValueFunction packValue =
+                                              VcdParser::Simd::getPackValue(level);
+                                      VcdParser::Tokenizer tokenizer(input.data(), input.size());
+                                      std::vector<uint8_t> states;
+                                      uint64_t values = 0;
+                                      for (VcdParser::TokenView token = tokenizer.getNextTokenView();
+                                           !token.empty(); token = tokenizer.getNextTokenView()) {
+                                          if (token[0] != 'b' || token.size < 2) {
+                                              continue;
+                                          }
+                                          const char *value = token.data + 1;
+                                          size_t length = token.size - 1;
+                                          if (findInvalidValue(value, value + length) != value + length) {
+                                              continue;
+                                          }
+                                          states.assign((length + 3) / 4, 0);
+                                          packValue(states.data(), value, length);
+                                          values++;
+                                      }
+                                      return values;
+                                  }});
+        }
+        benchmarks.push_back({"parse/per-bit", [](const std::string &input, uint64_t &arenaBytes) {
+            return parseFile(input, arenaBytes, VcdFormat::StorageMode::PerBit, 1);
+        }});
+        benchmarks.push_back({"parse/packed", [](const std::string &input, uint64_t &arenaBytes) {
+            return parseFile(input, arenaBytes, VcdFormat::StorageMode::Packed, 1);
+        }});
+        benchmarks.push_back({"parse/indexed", [](const std::string &input, uint64_t &arenaBytes) {
+            return parseFile(input, arenaBytes, VcdFormat::StorageMode::Indexed, 1);
+        }});
+        benchmarks.push_back({"parse/packed-threads", [](const std::string &input, uint64_t &arenaBytes) {
+            return parseFile(input, arenaBytes, VcdFormat::StorageMode::Packed, 0);
+        }});
+        benchmarks.push_back({"parse/packed-feed", [](const std::string &input, uint64_t &arenaBytes) {
+            VcdParser::VcdParser parser;
+            parser.setStorageMode(VcdFormat::StorageMode::Packed);
+            const size_t chunkSize = 64 * 1024;
+            for (size_t offset = 0; offset < input.size(); offset += chunkSize) {
+                parser.feed(input.data() + offset, std::min(chunkSize, input.size() - offset));
+            }
+            parser.finish();
+            VcdFormat::VcdFile &file = parser.getResult();
+            arenaBytes = file.arena->getAllocatedBytes();
+            return static_cast<uint64_t>(file.variableList.size());
+        }});
+        benchmarks.push_back({"parse/handler", [](const std::string &input, uint64_t &) {
+            CountingHandler handler;
+            VcdParser::VcdParser parser(input);
+            parser.setHandler(handler);
+            parser.parse();
+            return handler.changes;
+        }});
+        return benchmarks;
+    }
+
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "  --input FILE         benchmark FILE instead of generating the input\n"
+                  << "  --generate FILE      write the generated input to FILE and exit\n"
+                  << "  --signals N          number of variables (default 1000)\n"
+                  << "  --min-width N        smallest variable width (default 1)\n"
+                  << "  --max-width N        largest variable width (default 64)\n"
+                  << "  --id-length N        minimum length of identifier codes (default 1)\n"
+                  << "  --density F          fraction of variables changing per timestamp (default 0.05)\n"
+                  << "  --size BYTES         size of the generated input (default 64M, K/M/G suffixes)\n"
+                  << "  --seed N             generator seed (default 1)\n"
+                  << "  --repeat N           runs per benchmark, the fastest is reported (default 3)\n"
+                  << "  --filter TEXT        only run benchmarks whose name contains TEXT\n"
+                  << "  --expect NAME=MBPS   fail unless benchmark NAME reaches MBPS MB/s\n"
+                  << "Results are written to stdout as JSON." << std::endl;
+    }
+
+    uint64_t parseSize(const std::string &text) {
+        size_t end;
+        uint64_t value = std::stoull(text, &end);
+        switch (end < text.size() ? text[end] : '\0') {
+            case 'G':
+            case 'g':
+                return value << 30;
+            case 'M':
+            case 'm':
+                return value << 20;
+            case 'K':
+            case 'k':
+                return value << 10;
+            default:
+                return value;
+        }
+    }
+
+    std::string readFile(const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("Can't read " + path);
+        }
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        return contents.str();
+    }
+
+    std::string quote(const std::string &str) {
+        std::string quoted = "\"";
+        for (char ch : str) {
+            if (ch == '"' || ch == '\\') {
+                quoted += '\\';
+            }
+            quoted += ch;
+        }
+        return quoted + "\"";
+    }
+}
+
+int main(int argc, char **argv) {
+    VcdBench::GeneratorOptions options;
+    std::string inputPath;
+    std::string generatePath;
+    std::string filter;
+    unsigned int repeat = 3;
+    std::vector<std::pair<std::string, double>> expectations;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if (arg == "--input") {
+                inputPath = value;
+            } else if (arg == "--generate") {
+                generatePath = value;
+            } else if (arg == "--signals") {
+                options.signals = static_cast<unsigned int>(std::stoul(value));
+            } else if (arg == "--min-width") {
+                options.minWidth = static_cast<unsigned int>(std::stoul(value));
+            } else if (arg == "--max-width") {
+                options.maxWidth = static_cast<unsigned int>(std::stoul(value));
+            } else if (arg == "--id-length") {
+                options.identifierLength = static_cast<unsigned int>(std::stoul(value));
+            } else if (arg == "--density") {
+                options.density = std::stod(value);
+            } else if (arg == "--size") {
+                options.size = parseSize(value);
+            } else if (arg == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (arg == "--repeat") {
+                repeat = std::max(1ul, std::stoul(value));
+            } else if (arg == "--filter") {
+                filter = value;
+            } else if (arg == "--expect") {
+                size_t separator = value.find('=');
+                if (separator == std::string::npos) {
+                    throw std::invalid_argument("Expected NAME=MBPS, got " + value);
+                }
+                expectations.emplace_back(value.substr(0, separator), std::stod(value.substr(separator + 1)));
+            } else {
+                throw std::invalid_argument("Unknown option " + arg);
+            }
+        }
+        if (options.minWidth == 0) {
+            throw std::invalid_argument("--min-width must be at least 1");
+        }
+        if (options.maxWidth < options.minWidth) {
+            throw std::invalid_argument("--max-width must be at least --min-width");
+        }
+        if (options.signalsPerScope == 0) {
+            throw std::invalid_argument("Signals per scope must be at least 1");
+        }
+    } catch (const std::logic_error &error) {
+        std::cerr << error.what() << std::endl;
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    std::string input;
+    VcdBench::GeneratorStats stats;
+    try {
+        if (inputPath.empty()) {
+            input = VcdBench::generateVcd(options, stats);
+        } else {
+            input = readFile(inputPath);
+        }
+        if (!generatePath.empty()) {
+            std::ofstream out(generatePath, std::ios::binary);
+            out.write(input.data(), input.size());
+            if (!out) {
+                throw std::runtime_error("Can't write " + generatePath);
+            }
+            return 0;
+        }
+    } catch (const std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    // value changes in the input, which every parse benchmark goes through
+    uint64_t changes;
+    try {
+        CountingHandler handler;
+        VcdParser::VcdParser parser(input);
+        parser.setHandler(handler);
+        parser.parse();
+        changes = handler.changes;
+    } catch (const std::exception &error) {
+        std::cerr << "Can't parse the input: " << error.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "{\n  \"input\": {";
+    if (inputPath.empty()) {
+        std::cout << "\"seed\": " << options.seed << ", \"signals\": " << options.signals
+                  << ", \"min_width\": " << options.minWidth << ", \"max_width\": " << options.maxWidth
+                  << ", \"id_length\": " << options.identifierLength << ", \"density\": " << options.density
+                  << ", \"timestamps\": " << stats.timestamps << ", ";
+    } else {
+        std::cout << "\"path\": " << quote(inputPath) << ", ";
+    }
+    std::cout << "\"bytes\": " << input.size() << ", \"value_changes\": " << changes << "},\n  \"results\": [";
+
+    std::vector<std::pair<std::string, double>> throughputs;
+    bool first = true;
+    for (const NamedBenchmark &benchmark : getBenchmarks()) {
+        if (benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        Result best;
+        try {
+            for (unsigned int i = 0; i < repeat; i++) {
+                Result result = measureIsolated(input, benchmark.run);
+                if (i == 0 || result.seconds < best.seconds) {
+                    best = result;
+                }
+            }
+        } catch (const std::exception &error) {
+            std::cerr << benchmark.name << ": " << error.what() << std::endl;
+            return 1;
+        }
+        double megabytesPerSecond = input.size() / best.seconds / 1e6;
+        // the tokenizer benchmarks see tokens rather than value changes
+        bool countsChanges = benchmark.name.compare(0, 6, "parse/") == 0;
+        std::cout << (first ? "\n" : ",\n") << "    {\"name\": " << quote(benchmark.name)
+                  << ", \"bytes\": " << input.size()
+                  << ", \"seconds\": " << best.seconds
+                  << ", \"mb_per_s\": " << megabytesPerSecond;
+        if (countsChanges) {
+            std::cout << ", \"changes_per_s\": " << static_cast<uint64_t>(changes / best.seconds);
+        } else {
+            std::cout << ", \"tokens\": " << best.count;
+        }
+        std::cout << ", \"peak_rss_kb\": " << best.peakRssKb
+                  << ", \"allocations\": " << best.allocations
+                  << ", \"allocated_bytes\": " << best.allocatedBytes
+                  << ", \"arena_bytes\": " << best.arenaBytes << "}";
+        std::cout.flush();
+        first = false;
+        throughputs.emplace_back(benchmark.name, megabytesPerSecond);
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+
+    int status = 0;
+    for (const auto &expectation : expectations) {
+        bool found = false;
+        for (const auto &throughput : throughputs) {
+            if (throughput.first != expectation.first) {
+                continue;
+            }
+            found = true;
+            if (throughput.second < expectation.second) {
+                std::cerr << expectation.first << ": " << throughput.second << " MB/s, expected at least "
+                          << expectation.second << " MB/s" << std::endl;
+                status = 1;
+            }
+        }
+        if (!found) {
+            std::cerr << expectation.first << ": no such benchmark was run" << std::endl;
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: MIT
+
+#include "vcd_generator.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace VcdBench {
+    namespace {
+        // splitmix64, so the output doesn't depend on the standard library
+        class Random {
+            uint64_t state;
+
+        public:
+            explicit Random(uint64_t seed)
+                    : state(seed) {
+            }
+
+            uint64_t next() {
+                uint64_t z = (state += 0x9e3779b97f4a7c15);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+                return z ^ (z >> 31);
+            }
+
+            uint64_t below(uint64_t n) {
+                return next() % n;
+            }
+        };
+
+        struct Signal {
+            std::string identifier;
+            unsigned int width;
+        };
+
+        std::string makeIdentifier(uint64_t index, unsigned int minLength) {
+            std::string code;
+            do {
+                code += static_cast<char>(33 + index % 94);
+                index /= 94;
+            } while (index != 0);
+            while (code.size() < minLength) {
+                code += '!';
+            }
+            return code;
+        }
+
+        char randomBit(Random &random) {
+            // mostly 0 and 1, now and then x or z
+            uint64_t r = random.below(64);
+            return r == 0 ? 'x' : r == 1 ? 'z' : static_cast<char>('0' + (r & 1));
+        }
+
+        void appendChange(std::string &out, const Signal &signal, Random &random) {
+            if (signal.width == 1) {
+                out += randomBit(random);
+                out += signal.identifier;
+            } else {
+                out += 'b';
+                for (unsigned int i = 0; i < signal.width; i++) {
+                    out += randomBit(random);
+                }
+                out += ' ';
+                out += signal.identifier;
+            }
+            out += '\n';
+        }
+    }
+
+    std::string generateVcd(const GeneratorOptions &options, GeneratorStats &stats) {
+        Random random(options.seed);
+        std::vector<Signal> signals(options.signals);
+        unsigned int widthRange = std::max(options.maxWidth, options.minWidth) - options.minWidth + 1;
+        for (size_t i = 0; i < signals.size(); i++) {
+            signals[i].identifier = makeIdentifier(i, options.identifierLength);
+            signals[i].width = options.minWidth + static_cast<unsigned int>(random.below(widthRange));
+        }
+
+        std::string out;
+        out.reserve(options.size + 4096);
+        out += "$date\n    generated\n$end\n$version\n    vcdparser-bench\n$end\n$timescale 1ps $end\n";
+        out += "$scope module top $end\n";
+        for (size_t i = 0; i < signals.size(); i++) {
+            if (i % options.signalsPerScope == 0) {
+                if (i != 0) {
+                    out += "$upscope $end\n";
+                }
+                out += "$scope module m" + std::to_string(i / options.signalsPerScope) + " $end\n";
+            }
+            out += "$var wire " + std::to_string(signals[i].width) + " " + signals[i].identifier
+                   + " s" + std::to_string(i) + " $end\n";
+        }
+        if (!signals.empty()) {
+            out += "$upscope $end\n";
+        }
+        out += "$upscope $end\n$enddefinitions $end\n";
+
+        stats = GeneratorStats();
+        out += "#0\n$dumpvars\n";
+        stats.timestamps++;
+        for (const Signal &it : signals) {
+            appendChange(out, it, random);
+            stats.changes++;
+        }
+        out += "$end\n";
+
+        auto changesPerStep = static_cast<uint64_t>(options.density * signals.size() + 0.5);
+        changesPerStep = std::max<uint64_t>(changesPerStep, 1);
+        uint64_t time = 0;
+        while (out.size() < options.size && !signals.empty()) {
+            time += 1 + random.below(10);
+            out += '#';
+            out += std::to_string(time);
+            out += '\n';
+            stats.timestamps++;
+            for (uint64_t i = 0; i < changesPerStep; i++) {
+                appendChange(out, signals[random.below(signals.size())], random);
+                stats.changes++;
+            }
+        }
+        return out;
+    }
+}
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace VcdBench {
+    struct GeneratorOptions {
+        uint64_t seed = 1;
+        unsigned int signals = 1000;
+        // widths are drawn uniformly from [minWidth, maxWidth]; width 1 gives scalars
+        unsigned int minWidth = 1;
+        unsigned int maxWidth = 64;
+        // identifier codes have at least this many characters
+        unsigned int identifierLength = 1;
+        // fraction of the signals that change at each # record
+        double density = 0.05;
+        // the body is generated until the file reaches this size
+        uint64_t size = 64 * 1024 * 1024;
+        unsigned int signalsPerScope = 32;
+    };
+
+    struct GeneratorStats {
+        uint64_t timestamps = 0;
+        uint64_t changes = 0;
+    };
+
+    /**
+     * Generates a VCD file; the same options always give the same file.
+     */
+    std::string generateVcd(const GeneratorOptions &options, GeneratorStats &stats);
+}
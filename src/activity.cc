@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: MIT
+
+#include "activity.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace VcdFormat {
+    namespace {
+        // states of the 4 bits of a byte in the packed encoding, see VectorChanges
+        const uint8_t Lanes = 0x55;
+        const uint8_t AllX = LogicX * Lanes;
+
+        /**
+         * Counters of the packed bits of a variable, one array per bit position within a
+         * state byte, so the loops over the bytes of a change can be vectorized.
+         */
+        class PackedCounters {
+            size_t stride;
+            // [lane * stride + byte]
+            std::vector<uint64_t> toggles;
+            std::vector<uint64_t> rising;
+            std::vector<uint64_t> falling;
+            // [(state * 4 + lane) * stride + byte]
+            std::vector<uint64_t> occupancy;
+
+        public:
+            explicit PackedCounters(size_t stride)
+                    : stride(stride),
+                      toggles(4 * stride),
+                      rising(4 * stride),
+                      falling(4 * stride),
+                      occupancy(16 * stride) {
+            }
+
+            void addChange(const uint8_t *previous, const uint8_t *current) {
+                for (unsigned int lane = 0; lane < 4; lane++) {
+                    uint64_t *laneToggles = &toggles[lane * stride];
+                    uint64_t *laneRising = &rising[lane * stride];
+                    uint64_t *laneFalling = &falling[lane * stride];
+                    unsigned int shift = lane * 2;
+                    for (size_t i = 0; i < stride; i++) {
+                        unsigned int p = previous[i];
+                        unsigned int c = current[i];
+                        // low and high bit of every state, in the low bit of each lane
+                        unsigned int pl = p & Lanes, ph = (p >> 1) & Lanes;
+                        unsigned int cl = c & Lanes, ch = (c >> 1) & Lanes;
+                        unsigned int p0 = ~(pl | ph) & Lanes, p1 = pl & ~ph;
+                        unsigned int c0 = ~(cl | ch) & Lanes, c1 = cl & ~ch;
+                        unsigned int diff = p ^ c;
+                        laneToggles[i] += ((diff | diff >> 1) >> shift) & 1;
+                        // x and z have the high bit set
+                        laneRising[i] += (((p0 & (c1 | ch)) | (ph & c1)) >> shift) & 1;
+                        laneFalling[i] += (((p1 & (c0 | ch)) | (ph & c0)) >> shift) & 1;
+                    }
+                }
+            }
+
+            void addTime(const uint8_t *states, uint64_t duration) {
+                for (unsigned int state = 0; state < 4; state++) {
+                    unsigned int pattern = state * Lanes;
+                    for (unsigned int lane = 0; lane < 4; lane++) {
+                        uint64_t *counters = &occupancy[(state * 4 + lane) * stride];
+                        unsigned int shift = lane * 2;
+                        for (size_t i = 0; i < stride; i++) {
+                            unsigned int diff = states[i] ^ pattern;
+                            uint64_t equal = (~(diff | diff >> 1) >> shift) & 1;
+                            counters[i] += duration & (0 - equal);
+                        }
+                    }
+                }
+            }
+
+            void getResult(std::vector<BitActivity> &bits) const {
+                for (size_t bit = 0; bit < bits.size(); bit++) {
+                    size_t lane = bit % 4;
+                    size_t byte = bit / 4;
+                    BitActivity &activity = bits[bit];
+                    activity.toggles = toggles[lane * stride + byte];
+                    activity.rising = rising[lane * stride + byte];
+                    activity.falling = falling[lane * stride + byte];
+                    for (unsigned int state = 0; state < 4; state++) {
+                        activity.occupancy[state] = occupancy[(state * 4 + lane) * stride + byte];
+                    }
+                }
+            }
+        };
+
+        bool isRising(LogicState previous, LogicState current) {
+            return (previous == Logic0 && current != Logic0) || (previous >= LogicX && current == Logic1);
+        }
+
+        bool isFalling(LogicState previous, LogicState current) {
+            return (previous == Logic1 && current != Logic1) || (previous >= LogicX && current == Logic0);
+        }
+
+        bool matches(Edge edge, LogicState previous, LogicState current) {
+            switch (edge) {
+                case Edge::Rising:
+                    return isRising(previous, current);
+                case Edge::Falling:
+                    return isFalling(previous, current);
+                default:
+                    return previous != current;
+            }
+        }
+
+        void addChange(BitActivity &activity, LogicState previous, LogicState current) {
+            activity.toggles += previous != current;
+            activity.rising += isRising(previous, current);
+            activity.falling += isFalling(previous, current);
+        }
+
+        // end: first time not counted, stop: where the last state ends, at most end
+        void measurePacked(const VcdFile &file, const Variable &variable, uint64_t begin, uint64_t end,
+                           uint64_t stop, Activity &activity) {
+            const VectorChanges &changes = variable.changes;
+            PackedCounters counters(changes.stride);
+            std::vector<uint8_t> unknown(changes.stride, AllX);
+            const uint8_t *previous = unknown.data();
+            bool first = true;
+            uint64_t cursor = begin;
+            for (const ChangeIterator &it : file.getChanges(variable)) {
+                uint64_t time = it.time();
+                if (time >= end) {
+                    break;
+                }
+                if (time > cursor) {
+                    counters.addTime(previous, time - cursor);
+                    cursor = time;
+                }
+                if (time >= begin && !first) {
+                    counters.addChange(previous, it.states());
+                    activity.transitions += std::memcmp(previous, it.states(), changes.stride) != 0;
+                }
+                previous = it.states();
+                first = false;
+            }
+            if (stop > cursor) {
+                counters.addTime(previous, stop - cursor);
+            }
+            counters.getResult(activity.bits);
+        }
+
+        void measurePerBit(const Variable &variable, uint64_t begin, uint64_t end, uint64_t stop,
+                           Activity &activity) {
+            size_t width = variable.signalLists.size();
+            for (size_t bit = 0; bit < width; bit++) {
+                const std::vector<ValueChange> &values = variable.signalLists[width - 1 - bit].values;
+                BitActivity &result = activity.bits[bit];
+                LogicState previous = LogicX;
+                bool first = true;
+                uint64_t cursor = begin;
+                for (const ValueChange &change : values) {
+                    if (change.time >= end) {
+                        break;
+                    }
+                    if (change.time > cursor) {
+                        result.occupancy[previous] += change.time - cursor;
+                        cursor = change.time;
+                    }
+                    LogicState current = toLogicState(change.data);
+                    if (change.time >= begin && !first) {
+                        addChange(result, previous, current);
+                    }
+                    previous = current;
+                    first = false;
+                }
+                if (stop > cursor) {
+                    result.occupancy[previous] += stop - cursor;
+                }
+            }
+            // changes of the whole value, recorded for every bit at the same times
+            std::vector<size_t> positions(width);
+            while (width != 0) {
+                uint64_t time = UINT64_MAX;
+                for (size_t i = 0; i < width; i++) {
+                    const std::vector<ValueChange> &values = variable.signalLists[i].values;
+                    if (positions[i] < values.size()) {
+                        time = std::min(time, values[positions[i]].time);
+                    }
+                }
+                if (time >= end) {
+                    break;
+                }
+                bool changed = false;
+                for (size_t i = 0; i < width; i++) {
+                    const std::vector<ValueChange> &values = variable.signalLists[i].values;
+                    size_t &position = positions[i];
+                    if (position < values.size() && values[position].time == time) {
+                        changed |= position != 0 && time >= begin
+                                   && toLogicState(values[position - 1].data) != toLogicState(values[position].data);
+                        position++;
+                    }
+                }
+                activity.transitions += changed;
+            }
+        }
+    }
+
+    double BitActivity::getDutyCycle() const {
+        uint64_t total = occupancy[Logic0] + occupancy[Logic1] + occupancy[LogicX] + occupancy[LogicZ];
+        return total == 0 ? 0 : static_cast<double>(occupancy[Logic1]) / total;
+    }
+
+    Activity measureActivity(const VcdFile &file, const Variable &alias, uint64_t begin, uint64_t end) {
+        const Variable &variable = alias.getCanonical();
+        Activity activity;
+        uint64_t stop = file.timestamps.empty() ? begin : std::min(end, file.timestamps.back());
+        if (variable.isReal()) {
+            const RealChanges &changes = variable.realChanges;
+            for (size_t i = 1; i < changes.size() && changes[i].time < end; i++) {
+                activity.transitions += changes[i].time >= begin && changes[i].value != changes[i - 1].value;
+            }
+            return activity;
+        }
+        activity.bits.resize(variable.width);
+        if (!variable.signalLists.empty()) {
+            measurePerBit(variable, begin, end, stop, activity);
+        } else if (variable.changes.width != 0) {
+            measurePacked(file, variable, begin, end, stop, activity);
+        }
+        return activity;
+    }
+
+    bool findNextEdge(const VcdQuery &query, const Variable &alias, unsigned int bit, Edge edge,
+                      uint64_t after, uint64_t &time) {
+        const Variable &variable = alias.getCanonical();
+        if (after == UINT64_MAX || bit >= variable.width || variable.isReal()) {
+            return false;
+        }
+        std::string value = query.valueAt(variable, after);
+        LogicState previous = toLogicState(value[value.size() - 1 - bit]);
+        if (!variable.signalLists.empty()) {
+            unsigned int index = variable.width - 1 - bit;
+            for (const ValueChange &change : query.bitChangesBetween(variable, index, after + 1, UINT64_MAX)) {
+                LogicState current = toLogicState(change.data);
+                if (matches(edge, previous, current)) {
+                    time = change.time;
+                    return true;
+                }
+                previous = current;
+            }
+            return false;
+        }
+        for (const ChangeIterator &it : query.changesBetween(variable, after + 1, UINT64_MAX)) {
+            LogicState current = it.getBit(bit);
+            if (matches(edge, previous, current)) {
+                time = it.time();
+                return true;
+            }
+            previous = current;
+        }
+        return false;
+    }
+
+    void ActivityHandler::onVar(uint32_t /*id*/, const VcdParser::VarDefinition &var) {
+        variables.push_back(var);
+        activities.emplace_back();
+        states.emplace_back();
+        if (var.type != Real && var.type != Realtime) {
+            activities.back().bits.resize(var.size);
+            states.back().assign(var.size, LogicX);
+        }
+        changeTimes.push_back(0);
+        changed.push_back(false);
+        reals.push_back(0);
+    }
+
+    void ActivityHandler::update(uint32_t id, const char *value, size_t length) {
+        Activity &activity = activities[id];
+        std::vector<LogicState> &bits = states[id];
+        uint64_t duration = currentTime - changeTimes[id];
+        bool first = !changed[id];
+        bool transition = false;
+        for (size_t i = 0; i < bits.size(); i++) {
+            LogicState current = toLogicState(value[length - 1 - i]);
+            BitActivity &result = activity.bits[i];
+            result.occupancy[bits[i]] += duration;
+            if (!first) {
+                addChange(result, bits[i], current);
+                transition |= bits[i] != current;
+            }
+            bits[i] = current;
+        }
+        activity.transitions += transition;
+        changeTimes[id] = currentTime;
+        changed[id] = true;
+    }
+
+    void ActivityHandler::onFinish() {
+        for (size_t id = 0; id < activities.size(); id++) {
+            uint64_t duration = currentTime - changeTimes[id];
+            for (size_t i = 0; i < states[id].size(); i++) {
+                activities[id].bits[i].occupancy[states[id][i]] += duration;
+            }
+            changeTimes[id] = currentTime;
+        }
+    }
+}
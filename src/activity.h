@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "libvcdparser.h"
+#include "query.h"
+
+namespace VcdFormat {
+    /**
+     * Switching activity of one bit.
+     */
+    struct BitActivity {
+        // changes of the bit's state
+        uint64_t toggles = 0;
+        // posedges (0 to 1, x or z, and x or z to 1) and negedges (1 to 0, x or z, and x or z to 0)
+        uint64_t rising = 0;
+        uint64_t falling = 0;
+        // time spent in each LogicState
+        uint64_t occupancy[4] = {};
+
+        /**
+         * Share of the time spent at 1, 0 if no time passed.
+         */
+        double getDutyCycle() const;
+    };
+
+    struct Activity {
+        // changes that changed the value of the variable
+        uint64_t transitions = 0;
+        // bit 0 is the least significant bit; empty for real variables
+        std::vector<BitActivity> bits;
+    };
+
+    /**
+     * Activity of variable during begin <= time < end; time spent in a state is counted up to
+     * the last timestamp of the file at most. Before its first change a variable is x; that
+     * first change isn't counted as a toggle or transition. The transitions of a real variable
+     * are the changes to a different number, also not counting its first change. Indexed
+     * variables must have been loaded with VcdFile::load().
+     *
+     * Packed changes are processed a state byte (4 bits) at a time for all bits of a
+     * change at once, in loops the compiler can vectorize.
+     */
+    Activity measureActivity(const VcdFile &file, const Variable &variable,
+                             uint64_t begin = 0, uint64_t end = UINT64_MAX);
+
+    enum class Edge {
+        Rising,
+        Falling,
+        Any
+    };
+
+    /**
+     * Finds the first edge of a bit after time after.
+     * @param bit bit index, 0 is the least significant bit
+     * @param edge Edge::Any matches every change of the bit's state
+     * @return false if there is none, or if variable is real
+     */
+    bool findNextEdge(const VcdQuery &query, const Variable &variable, unsigned int bit, Edge edge,
+                      uint64_t after, uint64_t &time);
+
+    /**
+     * Handler that measures the activity of every variable while parsing, without storing
+     * the changes. The results match measureActivity() over the whole file.
+     */
+    class ActivityHandler : public VcdParser::VcdHandler {
+        std::vector<VcdParser::VarDefinition> variables;
+        std::vector<Activity> activities;
+        // current state of every bit, least significant bit first, and when it was reached
+        std::vector<std::vector<LogicState>> states;
+        std::vector<uint64_t> changeTimes;
+        std::vector<bool> changed;
+        // current value of every real variable
+        std::vector<double> reals;
+        uint64_t currentTime = 0;
+
+        void update(uint32_t id, const char *value, size_t length);
+
+    public:
+        /**
+         * Definitions of the variables, by id as in onVar().
+         */
+        const std::vector<VcdParser::VarDefinition> &getVariables() const {
+            return variables;
+        }
+
+        /**
+         * Activity of the variables, by id, once the whole file has been parsed.
+         */
+        const std::vector<Activity> &getActivities() const {
+            return activities;
+        }
+
+        void onVar(uint32_t id, const VcdParser::VarDefinition &var) override;
+
+        void onTime(uint64_t time) override {
+            currentTime = time;
+        }
+
+        void onScalarChange(uint32_t id, char value) override {
+            update(id, &value, 1);
+        }
+
+        void onVectorChange(uint32_t id, const VcdParser::TokenView &value) override {
+            update(id, value.data, value.size);
+        }
+
+        void onRealChange(uint32_t id, double value) override {
+            activities[id].transitions += changed[id] && value != reals[id];
+            reals[id] = value;
+            changed[id] = true;
+        }
+
+        void onFinish() override;
+    };
+}
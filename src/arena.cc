@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: MIT
+
+#include "arena.h"
+
+#include <cstdlib>
+
+namespace VcdFormat {
+    const size_t Arena::BlockSize;
+    const size_t Arena::MinBufferClass;
+    const size_t Arena::NumBufferClasses;
+
+    static const size_t BlockHeaderSize = (sizeof(void *) + alignof(std::max_align_t) - 1)
+                                          / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    void *Arena::allocateBlock(size_t size) {
+        auto *block = static_cast<Block *>(std::malloc(BlockHeaderSize + size));
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+        block->next = blocks;
+        blocks = block;
+        allocatedBytes += BlockHeaderSize + size;
+        return reinterpret_cast<char *>(block) + BlockHeaderSize;
+    }
+
+    void *Arena::allocate(size_t size, size_t align) {
+        auto current = reinterpret_cast<uintptr_t>(cursor);
+        uintptr_t aligned = (current + align - 1) & ~static_cast<uintptr_t>(align - 1);
+        if (cursor != nullptr && aligned + size <= reinterpret_cast<uintptr_t>(limit)) {
+            cursor = reinterpret_cast<char *>(aligned + size);
+            return reinterpret_cast<void *>(aligned);
+        }
+        if (size > BlockSize / 4) {
+            // large allocations get a block of their own and leave the current one alone
+            return allocateBlock(size);
+        }
+        cursor = static_cast<char *>(allocateBlock(BlockSize));
+        limit = cursor + BlockSize;
+        void *result = cursor;
+        cursor += size;
+        return result;
+    }
+
+    StringRef Arena::copyString(const char *str, size_t length) {
+        auto *data = static_cast<char *>(allocate(length + 1, 1));
+        std::memcpy(data, str, length);
+        data[length] = '\0';
+        StringRef ref;
+        ref.data = data;
+        ref.length = length;
+        return ref;
+    }
+
+    static size_t getBufferClass(size_t capacity) {
+        size_t sizeClass = 0;
+        while ((static_cast<size_t>(1) << sizeClass) < capacity) {
+            sizeClass++;
+        }
+        return sizeClass;
+    }
+
+    void *Arena::allocateBuffer(size_t &capacity) {
+        size_t sizeClass = getBufferClass(capacity);
+        if (sizeClass < MinBufferClass) {
+            sizeClass = MinBufferClass;
+        }
+        capacity = static_cast<size_t>(1) << sizeClass;
+        if (sizeClass < NumBufferClasses) {
+            FreeBuffer *buffer = freeBuffers[sizeClass];
+            if (buffer != nullptr) {
+                freeBuffers[sizeClass] = buffer->next;
+                return buffer;
+            }
+        }
+        return allocate(capacity);
+    }
+
+    void Arena::releaseBuffer(void *buffer, size_t capacity) {
+        size_t sizeClass = getBufferClass(capacity);
+        // only buffers from allocateBuffer() have a power-of-two capacity
+        if (buffer == nullptr || capacity != static_cast<size_t>(1) << sizeClass
+            || sizeClass < MinBufferClass || sizeClass >= NumBufferClasses) {
+            return;
+        }
+        auto *freeBuffer = static_cast<FreeBuffer *>(buffer);
+        freeBuffer->next = freeBuffers[sizeClass];
+        freeBuffers[sizeClass] = freeBuffer;
+    }
+
+    void Arena::clear() {
+        for (Finalizer *it = finalizers; it != nullptr; it = it->next) {
+            it->destroy(it->object);
+        }
+        finalizers = nullptr;
+        while (blocks != nullptr) {
+            Block *next = blocks->next;
+            std::free(blocks);
+            blocks = next;
+        }
+        cursor = nullptr;
+        limit = nullptr;
+        for (auto &it : freeBuffers) {
+            it = nullptr;
+        }
+        allocatedBytes = 0;
+    }
+
+    void ByteBuffer::reserve(Arena &arena, size_t newCapacity) {
+        if (newCapacity <= capacity) {
+            return;
+        }
+        if (newCapacity < capacity * 2) {
+            newCapacity = capacity * 2;
+        }
+        auto *newData = static_cast<uint8_t *>(arena.allocateBuffer(newCapacity));
+        if (size != 0) {
+            std::memcpy(newData, data, size);
+        }
+        arena.releaseBuffer(data, capacity);
+        data = newData;
+        capacity = newCapacity;
+    }
+
+    uint32_t StringPool::hash(const char *str, size_t length) {
+        // FNV-1a
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < length; i++) {
+            h ^= static_cast<unsigned char>(str[i]);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    size_t StringPool::findSlot(const char *str, size_t length) const {
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash(str, length) & mask;; i = (i + 1) & mask) {
+            const StringRef &slot = slots[i];
+            if (slot.data == nullptr
+                || (slot.length == length && std::memcmp(slot.data, str, length) == 0)) {
+                return i;
+            }
+        }
+    }
+
+    StringRef StringPool::intern(Arena &arena, const char *str, size_t length) {
+        if ((count + 1) * 2 > slots.size()) { // keep the load factor at most 1/2
+            StringRef empty;
+            empty.data = nullptr;
+            std::vector<StringRef> old(slots.size() < 16 ? 32 : slots.size() * 2, empty);
+            old.swap(slots);
+            for (const StringRef &it : old) {
+                if (it.data != nullptr) {
+                    slots[findSlot(it.data, it.length)] = it;
+                }
+            }
+        }
+        StringRef &slot = slots[findSlot(str, length)];
+        if (slot.data == nullptr) {
+            slot = arena.copyString(str, length);
+            count++;
+        }
+        return slot;
+    }
+
+    const char *StringPool::find(const char *str, size_t length) const {
+        return slots.empty() ? nullptr : slots[findSlot(str, length)].data;
+    }
+}
@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace VcdFormat {
+    /**
+     * NUL-terminated string owned by an Arena.
+     */
+    struct StringRef {
+        const char *data = "";
+        size_t length = 0;
+
+        size_t size() const {
+            return length;
+        }
+
+        bool empty() const {
+            return length == 0;
+        }
+
+        const char *c_str() const {
+            return data;
+        }
+
+        std::string str() const {
+            return std::string(data, length);
+        }
+
+        operator std::string() const {
+            return str();
+        }
+
+        bool operator==(const StringRef &other) const {
+            return length == other.length && std::memcmp(data, other.data, length) == 0;
+        }
+
+        bool operator==(const std::string &other) const {
+            return length == other.size() && std::memcmp(data, other.data(), length) == 0;
+        }
+
+        bool operator==(const char *other) const {
+            return std::strlen(other) == length && std::memcmp(data, other, length) == 0;
+        }
+
+        template<typename T>
+        bool operator!=(const T &other) const {
+            return !(*this == other);
+        }
+    };
+
+    inline std::ostream &operator<<(std::ostream &os, const StringRef &str) {
+        return os.write(str.data, static_cast<std::streamsize>(str.length));
+    }
+
+    /**
+     * Region allocator owning the objects of a VcdFile. Everything allocated from an arena
+     * is released at once when the arena is destroyed; destructors of non-trivially
+     * destructible objects created with create() run at that point, in reverse order.
+     *
+     * Growable buffers are served from power-of-two size classes, and buffers given back
+     * with releaseBuffer() are reused for later requests of the same class.
+     */
+    class Arena {
+        struct Block {
+            Block *next;
+        };
+
+        struct Finalizer {
+            void (*destroy)(void *);
+            void *object;
+            Finalizer *next;
+        };
+
+        struct FreeBuffer {
+            FreeBuffer *next;
+        };
+
+        static const size_t BlockSize = 64 * 1024;
+        static const size_t MinBufferClass = 4; // 16 bytes
+        static const size_t NumBufferClasses = 48;
+
+        Block *blocks = nullptr;
+        char *cursor = nullptr;
+        char *limit = nullptr;
+        Finalizer *finalizers = nullptr;
+        FreeBuffer *freeBuffers[NumBufferClasses] = {};
+        size_t allocatedBytes = 0;
+
+        void *allocateBlock(size_t size);
+
+        template<typename T>
+        static void destroy(void *object) {
+            static_cast<T *>(object)->~T();
+        }
+
+    public:
+        Arena() = default;
+
+        Arena(const Arena &) = delete;
+
+        Arena &operator=(const Arena &) = delete;
+
+        ~Arena() {
+            clear();
+        }
+
+        void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+        template<typename T, typename... Args>
+        T *create(Args &&... args) {
+            void *memory = allocate(sizeof(T), alignof(T));
+            T *object = new(memory) T(std::forward<Args>(args)...);
+            if (!std::is_trivially_destructible<T>::value) {
+                auto *finalizer = static_cast<Finalizer *>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+                finalizer->destroy = &destroy<T>;
+                finalizer->object = object;
+                finalizer->next = finalizers;
+                finalizers = finalizer;
+            }
+            return object;
+        }
+
+        StringRef copyString(const char *str, size_t length);
+
+        StringRef copyString(const std::string &str) {
+            return copyString(str.data(), str.size());
+        }
+
+        /**
+         * Allocates a buffer of at least capacity bytes and updates capacity to its actual size.
+         */
+        void *allocateBuffer(size_t &capacity);
+
+        /**
+         * Returns a buffer obtained from allocateBuffer() for reuse.
+         */
+        void releaseBuffer(void *buffer, size_t capacity);
+
+        /**
+         * Destroys all objects and releases all memory.
+         */
+        void clear();
+
+        /**
+         * Bytes obtained from the system, including unused space.
+         */
+        size_t getAllocatedBytes() const {
+            return allocatedBytes;
+        }
+    };
+
+    /**
+     * Growable byte buffer allocated from an Arena. It's trivially destructible: its memory
+     * is reclaimed with the arena.
+     *
+     * A buffer with data but a capacity of 0 borrows memory it doesn't own, such as a mapped
+     * cache file; it's copied to the arena before it's first appended to.
+     */
+    struct ByteBuffer {
+        uint8_t *data = nullptr;
+        size_t size = 0;
+        size_t capacity = 0;
+
+        void reserve(Arena &arena, size_t newCapacity);
+
+        /**
+         * Appends n zero bytes and returns a pointer to them.
+         */
+        uint8_t *grow(Arena &arena, size_t n) {
+            if (size + n > capacity) {
+                reserve(arena, size + n);
+            }
+            uint8_t *p = data + size;
+            std::memset(p, 0, n);
+            size += n;
+            return p;
+        }
+
+        void push_back(Arena &arena, uint8_t byte) {
+            if (size == capacity) {
+                reserve(arena, size + 1);
+            }
+            data[size++] = byte;
+        }
+
+        uint8_t operator[](size_t i) const {
+            return data[i];
+        }
+
+        bool empty() const {
+            return size == 0;
+        }
+    };
+
+    /**
+     * Set of strings stored once in an Arena, so equal names share their memory and
+     * interned strings can be compared by pointer.
+     */
+    class StringPool {
+        std::vector<StringRef> slots; // empty slots have a null data pointer
+        size_t count = 0;
+
+        static uint32_t hash(const char *str, size_t length);
+
+        size_t findSlot(const char *str, size_t length) const;
+
+    public:
+        StringRef intern(Arena &arena, const char *str, size_t length);
+
+        StringRef intern(Arena &arena, const std::string &str) {
+            return intern(arena, str.data(), str.size());
+        }
+
+        /**
+         * The interned copy of a string, or a null pointer if it hasn't been interned.
+         */
+        const char *find(const char *str, size_t length) const;
+    };
+}
@@ -0,0 +1,502 @@
+// SPDX-License-Identifier: MIT
+
+#include "cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace VcdFormat {
+    namespace Cache {
+        namespace {
+            const char Magic[8] = {'V', 'C', 'D', 'C', 'A', 'C', 'H', 'E'};
+            const uint32_t ByteOrderMark = 0x01020304;
+
+            struct FileHeader {
+                char magic[8];
+                uint32_t version;
+                uint32_t byteOrder;
+                uint64_t payloadSize; // bytes after the header
+                uint64_t checksum; // of the payload
+            };
+
+            // fields of the first column
+            enum MetaField {
+                TimeNumber,
+                TimeUnitField,
+                LastVariableChangeTime,
+                TimestampCount,
+                VariableCount,
+                DateOffset,
+                DateLength,
+                VersionOffset,
+                VersionLength,
+                StringsSize,
+                DeltasSize,
+                StatesSize,
+                RealsSize,
+                ScopeCount,
+                MetaFieldCount
+            };
+
+            // columns of the variables, in file order
+            enum VariableField {
+                NameOffset,
+                NameLength,
+                IdentifierOffset,
+                IdentifierLength,
+                Width,
+                ChangeCount,
+                LastTimeIndex,
+                DeltasOffset,
+                StatesOffset,
+                RealsOffset,
+                ScopeIndex, // NoScope for the root
+                AliasOf, // index of the variable holding the changes of an alias, NoAlias otherwise
+                Type, // VarType
+                VariableFieldCount
+            };
+
+            // columns of the scopes, in file order; parents come before their children
+            enum ScopeField {
+                ScopeNameOffset,
+                ScopeNameLength,
+                ScopeTypeOffset,
+                ScopeTypeLength,
+                ScopeParent, // NoScope for the root
+                ScopeFieldCount
+            };
+
+            const uint64_t NoScope = UINT64_MAX;
+            const uint64_t NoAlias = UINT64_MAX;
+
+            /**
+             * Multiplicative hash over 8-byte words; the payload is padded to a multiple of 8.
+             */
+            class Checksum {
+                uint64_t hash = 0x243f6a8885a308d3;
+                uint8_t pending[8] = {};
+                size_t pendingSize = 0;
+
+                void mix(const uint8_t *word) {
+                    uint64_t value;
+                    std::memcpy(&value, word, 8);
+                    hash ^= value * 0x9e3779b97f4a7c15;
+                    hash = (hash << 31 | hash >> 33) * 0xc2b2ae3d27d4eb4f;
+                }
+
+            public:
+                void update(const uint8_t *data, size_t size) {
+                    if (size == 0) { // data may be null
+                        return;
+                    }
+                    if (pendingSize != 0) {
+                        size_t length = std::min(size, sizeof(pending) - pendingSize);
+                        std::memcpy(pending + pendingSize, data, length);
+                        pendingSize += length;
+                        data += length;
+                        size -= length;
+                        if (pendingSize < sizeof(pending)) {
+                            return;
+                        }
+                        mix(pending);
+                        pendingSize = 0;
+                    }
+                    for (; size >= 8; data += 8, size -= 8) {
+                        mix(data);
+                    }
+                    std::memcpy(pending, data, size);
+                    pendingSize += size;
+                }
+
+                uint64_t value() const {
+                    return hash;
+                }
+            };
+
+            class Writer {
+                std::ofstream out;
+                Checksum checksum;
+                uint64_t size = 0;
+
+            public:
+                explicit Writer(const std::string &path)
+                        : out(path, std::ios::binary | std::ios::trunc) {
+                    if (!out.is_open()) {
+                        throw std::runtime_error("can't open " + path + " for writing");
+                    }
+                    FileHeader header = {};
+                    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+                }
+
+                void write(const void *data, size_t length) {
+                    if (length == 0) { // data may be null, e.g. an empty column
+                        return;
+                    }
+                    out.write(static_cast<const char *>(data), static_cast<std::streamsize>(length));
+                    checksum.update(static_cast<const uint8_t *>(data), length);
+                    size += length;
+                }
+
+                void writeColumn(const std::vector<uint64_t> &column) {
+                    write(column.data(), column.size() * sizeof(uint64_t));
+                }
+
+                void pad() {
+                    static const uint8_t zeros[8] = {};
+                    write(zeros, (8 - size % 8) % 8);
+                }
+
+                void close(const std::string &path) {
+                    FileHeader header = {};
+                    std::memcpy(header.magic, Magic, sizeof(Magic));
+                    header.version = Version;
+                    header.byteOrder = ByteOrderMark;
+                    header.payloadSize = size;
+                    header.checksum = checksum.value();
+                    out.seekp(0);
+                    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+                    out.close();
+                    if (out.fail()) {
+                        throw std::runtime_error("can't write " + path);
+                    }
+                }
+            };
+
+            size_t findTimeIndex(const std::vector<uint64_t> &timestamps, uint64_t time, size_t &cursor) {
+                while (cursor < timestamps.size() && timestamps[cursor] != time) {
+                    cursor++;
+                }
+                if (cursor == timestamps.size()) { // times went backwards
+                    cursor = std::find(timestamps.begin(), timestamps.end(), time) - timestamps.begin();
+                }
+                return cursor;
+            }
+
+            /**
+             * Packs the per-bit lists of variable; every change of a variable adds an entry to each bit.
+             */
+            VectorChanges packBits(const VcdFile &file, const Variable &variable, Arena &arena) {
+                const std::vector<SignalRecord> &lists = variable.signalLists;
+                VectorChanges changes;
+                changes.width = static_cast<unsigned int>(lists.size());
+                changes.stride = (changes.width + 3) / 4;
+                size_t cursor = 0;
+                for (size_t i = 0; i < lists[0].values.size(); i++) {
+                    size_t timeIndex = findTimeIndex(file.timestamps, lists[0].values[i].time, cursor);
+                    uint8_t *states = changes.append(arena, timeIndex);
+                    for (unsigned int bit = 0; bit < changes.width; bit++) {
+                        char value = lists[changes.width - 1 - bit].values[i].data;
+                        states[bit / 4] |= toLogicState(value) << (bit % 4 * 2);
+                    }
+                }
+                return changes;
+            }
+
+            class Reader {
+                const uint8_t *data;
+                size_t size;
+                size_t offset = 0;
+
+            public:
+                Reader(const uint8_t *data, size_t size)
+                        : data(data), size(size) {
+                }
+
+                const uint8_t *read(uint64_t length) {
+                    if (length > size - offset) {
+                        throw std::runtime_error("cache is truncated");
+                    }
+                    const uint8_t *result = data + offset;
+                    offset += (length + 7) / 8 * 8;
+                    offset = std::min(offset, size);
+                    return result;
+                }
+
+                const uint64_t *readColumn(uint64_t count) {
+                    if (count > size / sizeof(uint64_t)) {
+                        throw std::runtime_error("cache is truncated");
+                    }
+                    return reinterpret_cast<const uint64_t *>(read(count * sizeof(uint64_t)));
+                }
+            };
+
+            /**
+             * Whether the time deltas of changes hold count varints adding up to lastTimeIndex,
+             * an index into the timestamps. ChangeIterator decodes them without bounds checks.
+             */
+            bool checkTimeDeltas(const VectorChanges &changes, uint64_t timestampCount) {
+                const ByteBuffer &deltas = changes.timeDeltas;
+                uint64_t timeIndex = 0;
+                size_t count = 0;
+                size_t position = 0;
+                while (position < deltas.size) {
+                    uint64_t delta = 0;
+                    unsigned int shift = 0;
+                    uint8_t byte;
+                    do {
+                        if (position == deltas.size || shift >= 64) {
+                            return false;
+                        }
+                        byte = deltas[position++];
+                        delta |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                        shift += 7;
+                    } while (byte & 0x80);
+                    if (delta > changes.lastTimeIndex - timeIndex) {
+                        return false;
+                    }
+                    timeIndex += delta;
+                    count++;
+                }
+                return count == changes.count && timeIndex == changes.lastTimeIndex
+                       && (count == 0 || timeIndex < timestampCount);
+            }
+
+            StringRef getString(const uint8_t *strings, uint64_t stringsSize, uint64_t offset, uint64_t length) {
+                // strings are NUL-terminated
+                if (offset > stringsSize || length >= stringsSize - offset || strings[offset + length] != '\0') {
+                    throw std::runtime_error("cache is corrupt");
+                }
+                StringRef ref;
+                ref.data = reinterpret_cast<const char *>(strings + offset);
+                ref.length = length;
+                return ref;
+            }
+        }
+
+        void save(const VcdFile &file, const std::string &path) {
+            const std::vector<Variable *> &variables = file.variableList;
+            Arena packedArena;
+            std::vector<VectorChanges> packed(variables.size());
+            std::unordered_map<const Variable *, uint64_t> variableIndices;
+            for (size_t i = 0; i < variables.size(); i++) {
+                variableIndices[variables[i]] = i;
+                if (!variables[i]->signalLists.empty()) {
+                    packed[i] = packBits(file, *variables[i], packedArena);
+                } else {
+                    packed[i] = variables[i]->changes;
+                }
+            }
+
+            std::vector<uint64_t> meta(MetaFieldCount);
+            std::vector<std::vector<uint64_t>> columns(VariableFieldCount, std::vector<uint64_t>(variables.size()));
+            std::string strings;
+            auto addString = [&strings](const char *data, size_t length, uint64_t &offset, uint64_t &size) {
+                offset = strings.size();
+                size = length;
+                strings.append(data, length);
+                strings.push_back('\0');
+            };
+            addString(file.date.data(), file.date.size(), meta[DateOffset], meta[DateLength]);
+            addString(file.version.data(), file.version.size(), meta[VersionOffset], meta[VersionLength]);
+
+            // scopes in breadth first order, so parents come first
+            std::vector<const Scope *> scopes(1, file.root);
+            std::unordered_map<const Scope *, uint64_t> scopeIndices;
+            scopeIndices[file.root] = NoScope;
+            std::vector<std::vector<uint64_t>> scopeColumns(ScopeFieldCount);
+            for (size_t i = 0; i < scopes.size(); i++) {
+                for (const Scope *it : scopes[i]->scopes) {
+                    scopeIndices[it] = scopes.size() - 1;
+                    scopes.push_back(it);
+                    uint64_t offset, length;
+                    addString(it->name.data, it->name.length, offset, length);
+                    scopeColumns[ScopeNameOffset].push_back(offset);
+                    scopeColumns[ScopeNameLength].push_back(length);
+                    addString(it->type.data, it->type.length, offset, length);
+                    scopeColumns[ScopeTypeOffset].push_back(offset);
+                    scopeColumns[ScopeTypeLength].push_back(length);
+                    scopeColumns[ScopeParent].push_back(scopeIndices[scopes[i]]);
+                }
+            }
+            uint64_t deltasSize = 0;
+            uint64_t statesSize = 0;
+            uint64_t realsSize = 0;
+            for (size_t i = 0; i < variables.size(); i++) {
+                const Variable &variable = *variables[i];
+                addString(variable.name.data, variable.name.length,
+                          columns[NameOffset][i], columns[NameLength][i]);
+                addString(variable.identifier.data, variable.identifier.length,
+                          columns[IdentifierOffset][i], columns[IdentifierLength][i]);
+                // the declared width; the packed changes of real variables have none
+                columns[Width][i] = variable.width;
+                columns[ChangeCount][i] = packed[i].count;
+                columns[LastTimeIndex][i] = packed[i].lastTimeIndex;
+                columns[DeltasOffset][i] = deltasSize;
+                columns[StatesOffset][i] = statesSize;
+                columns[RealsOffset][i] = realsSize;
+                columns[ScopeIndex][i] = variable.scope != nullptr ? scopeIndices[variable.scope] : NoScope;
+                columns[Type][i] = static_cast<uint64_t>(variable.type);
+                columns[AliasOf][i] = variable.aliasOf != nullptr ? variableIndices[variable.aliasOf] : NoAlias;
+                deltasSize += packed[i].timeDeltas.size;
+                statesSize += packed[i].states.size;
+                realsSize += variable.realChanges.records.size;
+            }
+            meta[TimeNumber] = static_cast<uint64_t>(file.timescale.timeNumber);
+            meta[TimeUnitField] = static_cast<uint64_t>(file.timescale.timeUnit);
+            meta[LastVariableChangeTime] = file.lastVariableChangeTime;
+            meta[TimestampCount] = file.timestamps.size();
+            meta[VariableCount] = variables.size();
+            meta[StringsSize] = strings.size();
+            meta[DeltasSize] = deltasSize;
+            meta[StatesSize] = statesSize;
+            meta[RealsSize] = realsSize;
+            meta[ScopeCount] = scopes.size() - 1;
+
+            Writer writer(path);
+            writer.writeColumn(meta);
+            writer.writeColumn(file.timestamps);
+            for (const auto &column : columns) {
+                writer.writeColumn(column);
+            }
+            for (const auto &column : scopeColumns) {
+                writer.writeColumn(column);
+            }
+            writer.write(strings.data(), strings.size());
+            writer.pad();
+            for (const VectorChanges &changes : packed) {
+                writer.write(changes.timeDeltas.data, changes.timeDeltas.size);
+            }
+            writer.pad();
+            for (const VectorChanges &changes : packed) {
+                writer.write(changes.states.data, changes.states.size);
+            }
+            writer.pad();
+            for (const Variable *variable : variables) {
+                writer.write(variable->realChanges.records.data, variable->realChanges.records.size);
+            }
+            writer.pad();
+            writer.close(path);
+        }
+
+        VcdFile load(const std::string &path, bool verify) {
+            std::unique_ptr<VcdParser::MappedFile> mapped(new VcdParser::MappedFile(path, false));
+            const auto *data = reinterpret_cast<const uint8_t *>(mapped->data());
+            FileHeader header;
+            if (mapped->size() < sizeof(header)) {
+                throw std::runtime_error(path + " isn't a cache");
+            }
+            std::memcpy(&header, data, sizeof(header));
+            if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+                throw std::runtime_error(path + " isn't a cache");
+            }
+            if (header.version != Version || header.byteOrder != ByteOrderMark) {
+                throw std::runtime_error(path + " is a cache of another version or byte order");
+            }
+            const uint8_t *payload = data + sizeof(header);
+            if (header.payloadSize != mapped->size() - sizeof(header)) {
+                throw std::runtime_error(path + " is truncated");
+            }
+            if (verify) {
+                Checksum checksum;
+                checksum.update(payload, header.payloadSize);
+                if (checksum.value() != header.checksum) {
+                    throw std::runtime_error(path + " is corrupt");
+                }
+            }
+
+            Reader reader(payload, header.payloadSize);
+            const uint64_t *meta = reader.readColumn(MetaFieldCount);
+            const uint64_t *timestamps = reader.readColumn(meta[TimestampCount]);
+            uint64_t variableCount = meta[VariableCount];
+            const uint64_t *columns[VariableFieldCount];
+            for (auto &column : columns) {
+                column = reader.readColumn(variableCount);
+            }
+            uint64_t scopeCount = meta[ScopeCount];
+            const uint64_t *scopeColumns[ScopeFieldCount];
+            for (auto &column : scopeColumns) {
+                column = reader.readColumn(scopeCount);
+            }
+            const uint8_t *strings = reader.read(meta[StringsSize]);
+            const uint8_t *deltas = reader.read(meta[DeltasSize]);
+            const uint8_t *states = reader.read(meta[StatesSize]);
+            const uint8_t *reals = reader.read(meta[RealsSize]);
+
+            VcdFile file;
+            file.date = getString(strings, meta[StringsSize], meta[DateOffset], meta[DateLength]).str();
+            file.version = getString(strings, meta[StringsSize], meta[VersionOffset], meta[VersionLength]).str();
+            file.timescale.timeNumber = static_cast<int>(meta[TimeNumber]);
+            file.timescale.timeUnit = static_cast<TimeUnit>(meta[TimeUnitField]);
+            file.lastVariableChangeTime = meta[LastVariableChangeTime];
+            file.timestamps.assign(timestamps, timestamps + meta[TimestampCount]);
+            std::vector<Scope *> scopes;
+            scopes.reserve(scopeCount);
+            for (uint64_t i = 0; i < scopeCount; i++) {
+                uint64_t parent = scopeColumns[ScopeParent][i];
+                if (parent != NoScope && parent >= i) {
+                    throw std::runtime_error(path + " is corrupt");
+                }
+                StringRef name = getString(strings, meta[StringsSize],
+                                           scopeColumns[ScopeNameOffset][i], scopeColumns[ScopeNameLength][i]);
+                StringRef type = getString(strings, meta[StringsSize],
+                                           scopeColumns[ScopeTypeOffset][i], scopeColumns[ScopeTypeLength][i]);
+                scopes.push_back(file.createScope(type, name, parent == NoScope ? nullptr : scopes[parent]));
+            }
+            file.variableList.reserve(variableCount);
+            for (uint64_t i = 0; i < variableCount; i++) {
+                uint64_t scope = columns[ScopeIndex][i];
+                if (scope != NoScope && scope >= scopeCount) {
+                    throw std::runtime_error(path + " is corrupt");
+                }
+                StringRef name = getString(strings, meta[StringsSize], columns[NameOffset][i], columns[NameLength][i]);
+                StringRef identifier = getString(strings, meta[StringsSize],
+                                                 columns[IdentifierOffset][i], columns[IdentifierLength][i]);
+                if (columns[Width][i] > UINT32_MAX - 3) { // so that the stride doesn't overflow
+                    throw std::runtime_error(path + " is corrupt");
+                }
+                Variable *variable = file.createVariable(name, identifier, scope == NoScope ? nullptr : scopes[scope]);
+                variable->width = static_cast<unsigned int>(columns[Width][i]);
+                if (columns[Type][i] > Wor) {
+                    throw std::runtime_error(path + " is corrupt");
+                }
+                variable->type = static_cast<VarType>(columns[Type][i]);
+
+                VectorChanges &changes = variable->changes;
+                changes.width = variable->isReal() ? 0 : variable->width;
+                changes.stride = (changes.width + 3) / 4;
+                changes.count = columns[ChangeCount][i];
+                changes.lastTimeIndex = columns[LastTimeIndex][i];
+                uint64_t deltasEnd = i + 1 < variableCount ? columns[DeltasOffset][i + 1] : meta[DeltasSize];
+                uint64_t statesEnd = i + 1 < variableCount ? columns[StatesOffset][i + 1] : meta[StatesSize];
+                uint64_t realsEnd = i + 1 < variableCount ? columns[RealsOffset][i + 1] : meta[RealsSize];
+                // checked even without verify, the changes are read without bounds checks
+                if (columns[DeltasOffset][i] > deltasEnd || deltasEnd > meta[DeltasSize]
+                    || columns[StatesOffset][i] > statesEnd || statesEnd > meta[StatesSize]
+                    || (changes.stride != 0 && changes.count > meta[StatesSize] / changes.stride)
+                    || statesEnd - columns[StatesOffset][i] != changes.count * changes.stride
+                    || columns[RealsOffset][i] > realsEnd || realsEnd > meta[RealsSize]
+                    || columns[RealsOffset][i] % sizeof(RealValueChange) != 0
+                    || (realsEnd - columns[RealsOffset][i]) % sizeof(RealValueChange) != 0) {
+                    throw std::runtime_error(path + " is corrupt");
+                }
+                // borrowed from the mapping, see ByteBuffer
+                changes.timeDeltas.data = const_cast<uint8_t *>(deltas + columns[DeltasOffset][i]);
+                changes.timeDeltas.size = deltasEnd - columns[DeltasOffset][i];
+                if (!checkTimeDeltas(changes, meta[TimestampCount])) {
+                    throw std::runtime_error(path + " is corrupt");
+                }
+                changes.states.data = const_cast<uint8_t *>(states + columns[StatesOffset][i]);
+                changes.states.size = statesEnd - columns[StatesOffset][i];
+                ByteBuffer &records = variable->realChanges.records;
+                records.data = const_cast<uint8_t *>(reals + columns[RealsOffset][i]);
+                records.size = realsEnd - columns[RealsOffset][i];
+
+                uint64_t aliasOf = columns[AliasOf][i];
+                if (aliasOf != NoAlias) {
+                    // aliases come after the variable holding their changes, and have none of their own
+                    if (aliasOf >= i || file.variableList[aliasOf]->aliasOf != nullptr
+                        || changes.count != 0 || changes.timeDeltas.size != 0 || records.size != 0) {
+                        throw std::runtime_error(path + " is corrupt");
+                    }
+                    variable->aliasOf = file.variableList[aliasOf];
+                    variable->changes = VectorChanges();
+                }
+            }
+            file.mapping = std::move(mapped);
+            return file;
+        }
+    }
+}
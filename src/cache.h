@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <string>
+
+#include "libvcdparser.h"
+
+namespace VcdFormat {
+    /**
+     * Binary cache of a parsed VcdFile, so it can be reopened without parsing the text again.
+     *
+     * The file starts with a header holding a magic string, the format version, a byte
+     * order mark and a checksum of the rest. The contents follow as columns: the header
+     * commands, the timestamps, one array per field of the variables and of the scopes,
+     * then the names, the packed changes and the real changes of all variables, each
+     * concatenated into one blob. Every column starts at a multiple of 8 bytes. Values
+     * are stored in host byte order; a cache is rejected on a host with a different one.
+     */
+    namespace Cache {
+        static const uint32_t Version = 6;
+
+        /**
+         * Writes file to path. Variables stored with StorageMode::PerBit are converted
+         * to the packed encoding, so a loaded cache always uses StorageMode::Packed.
+         * Variables parsed with StorageMode::Indexed are written as far as they have been loaded.
+         * Aliases are written as references to the variable holding their changes.
+         * @throw std::runtime_error if the file can't be written.
+         */
+        void save(const VcdFile &file, const std::string &path);
+
+        /**
+         * Maps a cache written by save(). Change buffers point into the mapping, which the
+         * returned file keeps alive; only the timestamps, names and scopes are copied.
+         * @param verify whether to check the checksum, which reads the whole file; the offsets,
+         * sizes and time deltas of the changes are checked either way
+         * @throw std::runtime_error if the file can't be read, isn't a cache of this
+         * version or is corrupt.
+         */
+        VcdFile load(const std::string &path, bool verify = true);
+    }
+}
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: MIT
+
+#include "follow.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+VcdParser::FileFollower::FileFollower(const std::string &path, VcdFormat::StorageMode mode)
+        : file(std::fopen(path.c_str(), "rb")),
+          path(path),
+          buffer(1024 * 1024) {
+    if (file == nullptr) {
+        throw std::runtime_error("can't open " + path + ": " + std::strerror(errno));
+    }
+    // StorageMode::Indexed needs the whole input, fed input is stored packed instead
+    parser.setStorageMode(mode);
+}
+
+VcdParser::FileFollower::~FileFollower() {
+    stop();
+    std::fclose(file);
+}
+
+bool VcdParser::FileFollower::poll() {
+    size_t before = completed;
+    while (true) {
+        size_t read = std::fread(buffer.data(), 1, buffer.size(), file);
+        if (read != 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            parser.feed(buffer.data(), read);
+            publish();
+        }
+        if (read < buffer.size()) {
+            if (std::ferror(file)) {
+                throw std::runtime_error("can't read " + path);
+            }
+            // at the current end of the file, reading continues there next time
+            std::clearerr(file);
+            break;
+        }
+    }
+    published.notify_all();
+    return completed != before;
+}
+
+void VcdParser::FileFollower::publish() {
+    VcdFormat::VcdFile &result = parser.getResult();
+    // the block of the last timestamp may continue with the next bytes
+    size_t count = result.timestamps.empty() ? 0 : result.timestamps.size() - 1;
+    if (count > completed) {
+        completed = count;
+        completedTime = result.timestamps[completed - 1];
+        result.lastVariableChangeTime = completedTime;
+    }
+}
+
+void VcdParser::FileFollower::start(std::chrono::milliseconds interval) {
+    stop();
+    stopping = false;
+    thread = std::thread([this, interval]() {
+        try {
+            std::unique_lock<std::mutex> lock(threadMutex);
+            while (!stopping) {
+                lock.unlock();
+                poll();
+                lock.lock();
+                wakeUp.wait_for(lock, interval, [this]() {
+                    return stopping;
+                });
+            }
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = std::current_exception();
+            }
+            published.notify_all();
+        }
+    });
+}
+
+void VcdParser::FileFollower::stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(threadMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    thread.join();
+}
+
+void VcdParser::FileFollower::finish() {
+    stop();
+    throwIfFailed();
+    poll();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        parser.finish();
+        const std::vector<uint64_t> &timestamps = parser.getResult().timestamps;
+        completed = timestamps.size();
+        if (completed != 0) {
+            completedTime = timestamps.back();
+        }
+        finished = true;
+    }
+    published.notify_all();
+}
+
+void VcdParser::FileFollower::throwIfFailed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+bool VcdParser::FileFollower::getCompletedTime(uint64_t &time) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    time = completedTime;
+    return completed != 0;
+}
+
+bool VcdParser::FileFollower::waitForTime(uint64_t time, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    bool reached = published.wait_for(lock, timeout, [&]() {
+        return finished || error || (completed != 0 && completedTime >= time);
+    });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return reached;
+}
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libvcdparser.h"
+
+namespace VcdParser {
+    /**
+     * Parses a VCD file while a simulator is still appending to it.
+     *
+     * Every poll reads the bytes appended since the previous one and feeds them to a
+     * VcdParser. A time block is complete once the next # record has been parsed; the
+     * number of complete timestamps is published after each poll, and readers access the
+     * file through read(), which excludes parsing, so they always see a consistent state.
+     * The file is polled rather than watched, which works the same on every platform and
+     * file system.
+     */
+    class FileFollower {
+        std::FILE *file;
+        std::string path;
+        VcdParser parser;
+        std::vector<char> buffer;
+
+        mutable std::mutex mutex;
+        std::condition_variable published;
+        // timestamps of the file whose changes are final
+        size_t completed = 0;
+        uint64_t completedTime = 0;
+        bool finished = false;
+        std::exception_ptr error;
+
+        std::thread thread;
+        std::mutex threadMutex;
+        std::condition_variable wakeUp;
+        bool stopping = false;
+
+        void publish();
+
+        void throwIfFailed() const;
+
+    public:
+        /**
+         * Opens path, which may still be empty.
+         * @throw std::runtime_error if the file can't be opened.
+         */
+        explicit FileFollower(const std::string &path,
+                              VcdFormat::StorageMode mode = VcdFormat::StorageMode::Packed);
+
+        FileFollower(const FileFollower &) = delete;
+
+        FileFollower &operator=(const FileFollower &) = delete;
+
+        /**
+         * Stops the polling thread, if any.
+         */
+        ~FileFollower();
+
+        /**
+         * Parses the bytes appended since the last poll. Must not be called while the
+         * polling thread runs.
+         * @return whether new timestamps were completed
+         * @throw VcdParser::VcdException if the input is invalid; the follower can't continue after that.
+         * @throw std::runtime_error if the file can't be read.
+         */
+        bool poll();
+
+        /**
+         * Polls on a separate thread every interval until stop(). Errors are reported
+         * by waitForTime() and finish().
+         */
+        void start(std::chrono::milliseconds interval = std::chrono::milliseconds(10));
+
+        void stop();
+
+        /**
+         * Stops polling, parses the rest of the file and completes the result, once the
+         * simulator has finished writing it. All timestamps are complete afterwards.
+         */
+        void finish();
+
+        /**
+         * Calls reader(const VcdFormat::VcdFile &file, size_t completed) while no input is
+         * parsed. The changes at the first completed timestamps of file are final; later
+         * ones may still be missing changes and should be ignored. Anything derived from the
+         * file, like a VcdQuery or iterators, is only valid during the call.
+         */
+        template<typename Reader>
+        void read(Reader reader) {
+            std::lock_guard<std::mutex> lock(mutex);
+            const VcdFormat::VcdFile &result = parser.getResult();
+            reader(result, completed);
+        }
+
+        /**
+         * The last complete timestamp.
+         * @return false if no timestamp is complete yet
+         */
+        bool getCompletedTime(uint64_t &time) const;
+
+        /**
+         * Waits until a timestamp at or after time is complete, or the file has been finished.
+         * @return false if that didn't happen within timeout
+         * @throw the error that stopped the polling thread, if any
+         */
+        bool waitForTime(uint64_t time, std::chrono::milliseconds timeout);
+    };
+}
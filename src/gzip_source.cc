@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: MIT
+
+#include "gzip_source.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <zlib.h>
+
+VcdParser::GzipSource::GzipSource(const std::string &path, size_t bufferSize, size_t bufferCount)
+        : file(std::fopen(path.c_str(), "rb")),
+          path(path),
+          buffers(std::max<size_t>(bufferCount, 2), std::vector<char>(std::max<size_t>(bufferSize, 1))),
+          sizes(buffers.size()) {
+    if (file == nullptr) {
+        throw std::runtime_error("can't open " + path + ": " + std::strerror(errno));
+    }
+    thread = std::thread(&GzipSource::inflateFile, this);
+}
+
+VcdParser::GzipSource::~GzipSource() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+    condition.notify_all();
+    thread.join();
+    std::fclose(file);
+}
+
+void VcdParser::GzipSource::inflateFile() {
+    z_stream stream{};
+    // 32 detects the gzip or zlib header
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::make_exception_ptr(std::runtime_error("can't initialize zlib"));
+        done = true;
+        condition.notify_all();
+        return;
+    }
+    std::vector<unsigned char> input(256 * 1024);
+    bool inputEnded = false;
+    // whether a member has ended and no other one has started since, so that the input may
+    // end here; an empty file has no member and is truncated
+    bool memberEnded = false;
+    // keeps the unconsumed input and appends what's left of the file after it
+    auto readInput = [&]() {
+        size_t kept = stream.avail_in;
+        if (kept != 0) { // next_in is null before the first read
+            std::memmove(input.data(), stream.next_in, kept);
+        }
+        size_t read = std::fread(input.data() + kept, 1, input.size() - kept, file);
+        if (read < input.size() - kept) {
+            if (std::ferror(file)) {
+                throw std::runtime_error("can't read " + path);
+            }
+            inputEnded = true;
+        }
+        stream.next_in = input.data();
+        stream.avail_in = static_cast<uInt>(kept + read);
+    };
+    try {
+        size_t index = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]() {
+                    return cancelled || filled - consumed < buffers.size();
+                });
+                if (cancelled) {
+                    break;
+                }
+                index = filled % buffers.size();
+            }
+            // the buffer belongs to this thread until it's counted as filled
+            std::vector<char> &buffer = buffers[index];
+            stream.next_out = reinterpret_cast<unsigned char *>(buffer.data());
+            stream.avail_out = static_cast<uInt>(buffer.size());
+            bool ended = false;
+            while (stream.avail_out != 0) {
+                // the magic bytes of the next member may be split across reads
+                if (stream.avail_in < (memberEnded ? 2u : 1u) && !inputEnded) {
+                    readInput();
+                }
+                if (stream.avail_in == 0 && inputEnded) {
+                    if (!memberEnded) {
+                        throw std::runtime_error(path + " is truncated");
+                    }
+                    ended = true;
+                    break;
+                }
+                if (memberEnded) {
+                    // padding or other data after the last member, which gunzip ignores too
+                    if (stream.avail_in < 2 || stream.next_in[0] != 0x1f || stream.next_in[1] != 0x8b) {
+                        uint64_t ignored = stream.avail_in;
+                        while (!inputEnded) {
+                            stream.avail_in = 0;
+                            readInput();
+                            ignored += stream.avail_in;
+                        }
+                        std::lock_guard<std::mutex> lock(mutex);
+                        trailingSize = ignored;
+                        ended = true;
+                        break;
+                    }
+                    memberEnded = false;
+                }
+                int status = inflate(&stream, Z_NO_FLUSH);
+                if (status == Z_STREAM_END) {
+                    // another member may follow
+                    memberEnded = true;
+                    inflateReset(&stream);
+                } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                    throw std::runtime_error(path + " can't be decompressed: "
+                                             + (stream.msg != nullptr ? stream.msg : "invalid data"));
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                sizes[index] = buffer.size() - stream.avail_out;
+                if (sizes[index] != 0) {
+                    filled++;
+                }
+                done = ended;
+            }
+            condition.notify_all();
+            if (ended) {
+                break;
+            }
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::current_exception();
+        done = true;
+        condition.notify_all();
+    }
+    inflateEnd(&stream);
+}
+
+uint64_t VcdParser::GzipSource::getTrailingSize() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return trailingSize;
+}
+
+bool VcdParser::GzipSource::next(const char *&data, size_t &size) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (holding) {
+        consumed++;
+        holding = false;
+        condition.notify_all();
+    }
+    condition.wait(lock, [&]() {
+        return filled > consumed || done;
+    });
+    if (filled > consumed) {
+        size_t index = consumed % buffers.size();
+        data = buffers[index].data();
+        size = sizes[index];
+        holding = true;
+        return true;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return false;
+}
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "input_source.h"
+
+namespace VcdParser {
+    /**
+     * StreamSource that decompresses a gzip (or zlib) file on a separate thread.
+     *
+     * The thread inflates into a ring of buffers while the parser consumes the filled
+     * ones, so decompressing and parsing overlap. Concatenated gzip members are read one
+     * after the other, like gunzip does; data after the last member that doesn't start
+     * another one is ignored, see getTrailingSize().
+     */
+    class GzipSource : public StreamSource {
+        std::FILE *file;
+        std::string path;
+        std::vector<std::vector<char>> buffers;
+        std::vector<size_t> sizes;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        // buffers filled by the thread and handed back by next(), buffer i % buffers.size() is next
+        size_t filled = 0;
+        size_t consumed = 0;
+        // whether next() returned a buffer that hasn't been handed back yet
+        bool holding = false;
+        bool done = false;
+        bool cancelled = false;
+        uint64_t trailingSize = 0;
+        std::exception_ptr error;
+        std::thread thread;
+
+        void inflateFile();
+
+    public:
+        /**
+         * Opens path and starts decompressing it.
+         * @param bufferSize size of each buffer of decompressed data
+         * @param bufferCount number of buffers in the ring, at least 2
+         * @throw std::runtime_error if the file can't be opened. Files that are empty, truncated
+         * or not compressed make next() throw it.
+         */
+        explicit GzipSource(const std::string &path, size_t bufferSize = 1024 * 1024, size_t bufferCount = 4);
+
+        GzipSource(const GzipSource &) = delete;
+
+        GzipSource &operator=(const GzipSource &) = delete;
+
+        ~GzipSource() override;
+
+        bool next(const char *&data, size_t &size) override;
+
+        /**
+         * Number of bytes after the last member that were ignored because they don't start
+         * another one, e.g. padding. Complete once next() has returned false.
+         */
+        uint64_t getTrailingSize();
+    };
+}
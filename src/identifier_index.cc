@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: MIT
+
+#include "identifier_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace VcdParser {
+    const uint32_t IdentifierIndex::NotFound;
+    const size_t IdentifierIndex::MaxDenseLength;
+
+    // dense table entries allowed per inserted code before falling back to hashing
+    static const uint64_t MaxDenseSparseness = 4;
+    static const uint64_t MinDenseSize = 94 + 94 * 94;
+
+    uint32_t IdentifierIndex::hash(const TokenView &code) {
+        // FNV-1a
+        uint32_t h = 2166136261u;
+        for (char ch : code) {
+            h ^= static_cast<unsigned char>(ch);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    size_t IdentifierIndex::findSlot(const TokenView &code, uint32_t h) const {
+        size_t mask = slots.size() - 1;
+        size_t i = h & mask;
+        while (true) {
+            const Slot &slot = slots[i];
+            if (slot.id == NotFound
+                || (slot.length == code.size && std::memcmp(keys.data() + slot.offset, code.data, code.size) == 0)) {
+                return i;
+            }
+            i = (i + 1) & mask;
+        }
+    }
+
+    uint32_t IdentifierIndex::findHashed(const TokenView &code) const {
+        if (slots.empty()) {
+            return NotFound;
+        }
+        return slots[findSlot(code, hash(code))].id;
+    }
+
+    void IdentifierIndex::grow() {
+        std::vector<Slot> old(slots.empty() ? 64 : slots.size() * 2);
+        old.swap(slots);
+        for (const Slot &slot : old) {
+            if (slot.id != NotFound) {
+                TokenView code(keys.data() + slot.offset, slot.length);
+                slots[findSlot(code, hash(code))] = slot;
+            }
+        }
+    }
+
+    void IdentifierIndex::insert(const TokenView &code, uint32_t id) {
+        if ((count + 1) * 2 > slots.size()) {
+            grow();
+        }
+        Slot &slot = slots[findSlot(code, hash(code))];
+        if (slot.id == NotFound) {
+            slot.offset = static_cast<uint32_t>(keys.size());
+            slot.length = static_cast<uint32_t>(code.size);
+            keys.append(code.data, code.size);
+            count++;
+        }
+        slot.id = id;
+
+        uint64_t key;
+        if (code.size != 0 && code.size <= MaxDenseLength && decode(code, key) && key < dense.size()) {
+            dense[key] = id;
+        }
+    }
+
+    void IdentifierIndex::build() {
+        uint64_t limit = std::max<uint64_t>(count * MaxDenseSparseness, MinDenseSize);
+        uint64_t denseSize = 0;
+        for (const Slot &slot : slots) {
+            uint64_t key;
+            if (slot.id != NotFound && slot.length <= MaxDenseLength
+                && decode(TokenView(keys.data() + slot.offset, slot.length), key) && key < limit) {
+                denseSize = std::max(denseSize, key + 1);
+            }
+        }
+        dense.assign(denseSize, NotFound);
+        // codes beyond the table stay in the hash table only, which find() falls back to
+        for (const Slot &slot : slots) {
+            uint64_t key;
+            if (slot.id != NotFound && slot.length <= MaxDenseLength
+                && decode(TokenView(keys.data() + slot.offset, slot.length), key) && key < denseSize) {
+                dense[key] = slot.id;
+            }
+        }
+    }
+}
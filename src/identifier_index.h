@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tokenizer.h"
+
+namespace VcdParser {
+    /**
+     * Maps VCD identifier codes to variable ids.
+     *
+     * Identifier codes are short strings of printable ASCII (33..126), usually handed out
+     * sequentially by the simulator. Codes of up to MaxDenseLength characters are decoded
+     * as base-94 numbers into a dense table once all codes are known; other codes, and
+     * codes whose number would make the table too sparse, are kept in an open-addressing
+     * hash table.
+     */
+    class IdentifierIndex {
+    public:
+        static const uint32_t NotFound = UINT32_MAX;
+        static const size_t MaxDenseLength = 4;
+
+    private:
+        struct Slot {
+            uint32_t offset; // of the code in keys
+            uint32_t length;
+            uint32_t id = NotFound;
+        };
+
+        std::vector<uint32_t> dense;
+        std::vector<Slot> slots;
+        std::string keys;
+        size_t count = 0;
+
+        static inline bool decode(const TokenView &code, uint64_t &key) {
+            // codes of each length occupy their own range, so "!" and "!!" don't collide
+            static const uint64_t lengthOffsets[MaxDenseLength + 1] = {
+                    0, 0, 94, 94 + 94 * 94, 94 + 94 * 94 + 94 * 94 * 94
+            };
+            uint64_t value = 0;
+            for (size_t i = code.size; i > 0; i--) {
+                unsigned digit = static_cast<unsigned char>(code[i - 1]) - 33u;
+                if (digit >= 94) {
+                    return false;
+                }
+                value = value * 94 + digit;
+            }
+            key = lengthOffsets[code.size] + value;
+            return true;
+        }
+
+        static uint32_t hash(const TokenView &code);
+
+        size_t findSlot(const TokenView &code, uint32_t h) const;
+
+        uint32_t findHashed(const TokenView &code) const;
+
+        void grow();
+
+    public:
+        /**
+         * Sets the id of code, replacing the previous one.
+         */
+        void insert(const TokenView &code, uint32_t id);
+
+        /**
+         * Builds the dense table from the codes inserted so far. Codes inserted afterwards
+         * are still found, through the hash table.
+         */
+        void build();
+
+        inline uint32_t find(const TokenView &code) const {
+            uint64_t key;
+            if (code.size != 0 && code.size <= MaxDenseLength && decode(code, key) && key < dense.size()) {
+                return dense[key];
+            }
+            return findHashed(code);
+        }
+
+        /**
+         * Whether find(code) is answered by the dense table rather than the hash table.
+         */
+        inline bool isDense(const TokenView &code) const {
+            uint64_t key;
+            return code.size != 0 && code.size <= MaxDenseLength && decode(code, key) && key < dense.size();
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+        /**
+         * Bytes allocated by the tables.
+         */
+        size_t getMemoryUsage() const {
+            return dense.capacity() * sizeof(uint32_t) + slots.capacity() * sizeof(Slot) + keys.capacity();
+        }
+    };
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MIT
+
+#include "input_source.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+VcdParser::MappedFile::MappedFile(const std::string &path, bool /*sequential*/) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) {
+        throw std::runtime_error("can't open " + path);
+    }
+    f.seekg(0, std::ios::end);
+    buffer.resize(static_cast<size_t>(f.tellg()));
+    f.seekg(0, std::ios::beg);
+    f.read(buffer.data(), buffer.size());
+    mappedData = buffer.data();
+    mappedSize = buffer.size();
+}
+
+VcdParser::MappedFile::~MappedFile() = default;
+
+void VcdParser::MappedFile::release(size_t /*offset*/) {
+}
+
+#else
+
+VcdParser::MappedFile::MappedFile(const std::string &path, bool sequential) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("can't open " + path + ": " + std::strerror(errno));
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("can't stat " + path + ": " + std::strerror(err));
+    }
+    mappedSize = static_cast<size_t>(st.st_size);
+    if (mappedSize == 0) {
+        ::close(fd);
+        mappedData = "";
+        return;
+    }
+    void *addr = ::mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    ::close(fd); // the mapping keeps its own reference to the file
+    if (addr == MAP_FAILED) {
+        mappedSize = 0;
+        throw std::runtime_error("can't map " + path + ": " + std::strerror(err));
+    }
+    if (sequential) {
+        ::madvise(addr, mappedSize, MADV_SEQUENTIAL);
+    }
+    mappedData = static_cast<const char *>(addr);
+}
+
+VcdParser::MappedFile::~MappedFile() {
+    if (mappedSize != 0) {
+        ::munmap(const_cast<char *>(mappedData), mappedSize);
+    }
+}
+
+void VcdParser::MappedFile::release(size_t offset) {
+    static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    if (offset > mappedSize) {
+        offset = mappedSize;
+    }
+    size_t end = offset / pageSize * pageSize;
+    if (end <= releasedOffset) {
+        return;
+    }
+    ::madvise(const_cast<char *>(mappedData) + releasedOffset, end - releasedOffset, MADV_DONTNEED);
+    releasedOffset = end;
+}
+
+#endif
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace VcdParser {
+    /**
+     * A contiguous, read-only block of VCD text the parser can tokenize in place.
+     * Like the buffer constructor of VcdParser, the parser only borrows the source,
+     * so it must outlive every parser created from it.
+     */
+    class InputSource {
+    public:
+        virtual ~InputSource() = default;
+
+        virtual const char *data() const = 0;
+
+        virtual size_t size() const = 0;
+
+        /**
+         * Tells the source that the parser won't read bytes before offset again,
+         * so they can be dropped from memory.
+         */
+        virtual void release(size_t /*offset*/) {
+        }
+    };
+
+    /**
+     * InputSource backed by a read-only memory mapping of a file, by default read with
+     * sequential readahead. Pages released by the parser are dropped from the resident
+     * set and fault back in from the page cache if they are touched again.
+     */
+    class MappedFile : public InputSource {
+        const char *mappedData = nullptr;
+        size_t mappedSize = 0;
+        size_t releasedOffset = 0;
+#ifdef _WIN32
+        std::vector<char> buffer;
+#endif
+    public:
+        /**
+         * Maps the whole file at path.
+         * @param sequential whether the file is read front to back, rather than at random
+         * @throw std::runtime_error if the file can't be opened or mapped.
+         */
+        explicit MappedFile(const std::string &path, bool sequential = true);
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile() override;
+
+        const char *data() const override {
+            return mappedData;
+        }
+
+        size_t size() const override {
+            return mappedSize;
+        }
+
+        void release(size_t offset) override;
+    };
+
+    /**
+     * Input that arrives as a sequence of blocks, e.g. from a decompressor, for
+     * VcdParser::parseStream(). Implementations for other codecs only need to hand out
+     * their output block by block.
+     */
+    class StreamSource {
+    public:
+        virtual ~StreamSource() = default;
+
+        /**
+         * Returns the next block of input. The block stays valid until the next call.
+         * @return false once the input is exhausted
+         * @throw std::runtime_error if the input can't be read or decoded.
+         */
+        virtual bool next(const char *&data, size_t &size) = 0;
+    };
+}
@@ -3,60 +3,346 @@
 #include "libvcdparser.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <cstdarg>
+#include <cstdlib>
 #include <map>
 
 using namespace VcdFormat;
 
+namespace VcdParser {
+    const uint32_t ScopeDefinition::Root;
+
+    static const Simd::FindInvalidValueFunction findInvalidValue = Simd::getFindInvalidValue(
+            Simd::getSupportedLevel());
+}
+
 namespace VcdFormat {
-#if 0
-    VcdFile::~VcdFile() {
-        for (auto &it : signalList) {
-            delete it;
+    VcdFile::VcdFile()
+            : arena(new Arena()) {
+        root = arena->create<Scope>();
+    }
+
+    VcdFile::VcdFile(VcdFile &&) noexcept = default;
+
+    VcdFile &VcdFile::operator=(VcdFile &&) noexcept = default;
+
+    // variables live in the arena and are destroyed with it
+    VcdFile::~VcdFile() = default;
+
+    void VectorChanges::pack(uint8_t *states, const char *value, size_t length) {
+        static const VcdParser::Simd::PackValueFunction packValue = VcdParser::Simd::getPackValue(
+                VcdParser::Simd::getSupportedLevel());
+        packValue(states, value, length);
+    }
+
+    std::string VectorChanges::getValue(size_t change) const {
+        std::string value(width, '0');
+        for (unsigned int i = 0; i < width; i++) {
+            value[width - 1 - i] = toChar(getBit(change, i));
+        }
+        return value;
+    }
+
+    uint8_t *VectorChanges::append(Arena &arena, uint64_t timeIndex) {
+        uint64_t delta = timeIndex - lastTimeIndex;
+        while (delta >= 0x80) {
+            timeDeltas.push_back(arena, static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
         }
+        timeDeltas.push_back(arena, static_cast<uint8_t>(delta));
+        lastTimeIndex = timeIndex;
+        count++;
+        return states.grow(arena, stride);
     }
 
-    SignalRecord *VcdFile::createSignal() {
-        auto *recode = new SignalRecord();
-        signalList.push_back(recode);
-        return recode;
+    void ChangeOffsets::append(Arena &arena, uint64_t offset) {
+        uint64_t delta = offset - lastOffset;
+        while (delta >= 0x80) {
+            deltas.push_back(arena, static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        deltas.push_back(arena, static_cast<uint8_t>(delta));
+        lastOffset = offset;
+        count++;
     }
-#else
 
-    VcdFile::~VcdFile() = default;
+    static uint64_t readVarint(const ByteBuffer &buffer, size_t &position) {
+        uint64_t value = 0;
+        unsigned int shift = 0;
+        uint8_t byte;
+        do {
+            byte = buffer[position++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return value;
+    }
 
-#endif
+    static void throwLoadException(const char *input, uint64_t offset, const std::string &msg) {
+        size_t line, column;
+        VcdParser::Utils::locateOffset(input, offset, line, column);
+        throw VcdParser::VcdException(msg, line, column);
+    }
+
+    void VcdFile::load(Variable &variable) {
+        ChangeOffsets &offsets = variable.getCanonical().offsets;
+        VectorChanges &changes = variable.getCanonical().changes;
+        size_t position = 0;
+        uint64_t offset = 0;
+        size_t timeIndex = 0;
+        for (size_t i = 0; i < offsets.count; i++) {
+            offset += readVarint(offsets.deltas, position);
+            // the last # record before the change
+            timeIndex = std::upper_bound(timeOffsets.begin() + timeIndex, timeOffsets.end(), offset)
+                        - timeOffsets.begin() - 1;
+
+            const char *value = input + offset;
+            size_t length = 1;
+            bool vector = *value == 'b' || *value == 'B';
+            // errors are reported where the parser would: at the identifier of a vector change
+            uint64_t errorOffset = offset;
+            if (vector) {
+                value++;
+                length = 0;
+                while (value + length < input + inputSize && !VcdParser::Simd::isDelimiter(value[length])) {
+                    length++;
+                }
+                errorOffset = value + length - input;
+                while (errorOffset < inputSize && VcdParser::Simd::isDelimiter(input[errorOffset])) {
+                    errorOffset++;
+                }
+                if (length == 0 || length > changes.width) {
+                    throwLoadException(input, errorOffset,
+                                       "invalid vector value change definition: unexpected value size "
+                                       + std::to_string(length));
+                }
+            }
+            const char *invalid = VcdParser::findInvalidValue(value, value + length);
+            if (invalid != value + length) {
+                throwLoadException(input, errorOffset, std::string(vector ? "invalid vector" : "invalid scalar")
+                                                       + " value change definition: value " + *invalid + " is invalid");
+            }
 
-    Variable *VcdFile::createVariable(std::string name, std::string identifier) {
-        auto *variable = new Variable();
-        variable->name = std::move(name);
-        variable->identifier = std::move(identifier);
+            uint8_t *states = changes.append(*arena, timeIndex);
+            VectorChanges::pack(states, value, length);
+            // left-extend with 0 if the leftmost bit is 0 or 1, or with the leftmost bit otherwise
+            LogicState fill = value[0] == '1' ? Logic0 : toLogicState(value[0]);
+            for (size_t bit = length; bit < changes.width; bit++) {
+                states[bit / 4] |= fill << (bit % 4 * 2);
+            }
+        }
+        offsets = ChangeOffsets();
+    }
+
+    std::vector<ValueChange> VcdFile::getBitChanges(const Variable &alias, unsigned int index) const {
+        const Variable &variable = alias.getCanonical();
+        if (!variable.signalLists.empty()) {
+            return variable.signalLists[index].values;
+        }
+        std::vector<ValueChange> values;
+        values.reserve(variable.changes.size());
+        unsigned int bit = variable.width - 1 - index;
+        for (const ChangeIterator &it : getChanges(variable)) {
+            values.push_back({it.time(), toChar(it.getBit(bit))});
+        }
+        return values;
+    }
+
+    Variable *VcdFile::createVariable(const std::string &name, const std::string &identifier, Scope *scope) {
+        if (scope == nullptr) {
+            scope = root;
+        }
+        auto *variable = arena->create<Variable>();
+        variable->name = names.intern(*arena, name);
+        variable->identifier = arena->copyString(identifier);
+        variable->scope = scope;
+        scope->variables.push_back(variable);
+        variableIndex.emplace(ChildKey{scope, variable->name.data}, variable);
         variableList.push_back(variable);
         return variable;
     }
+
+    Scope *VcdFile::createScope(const std::string &type, const std::string &name, Scope *parent) {
+        if (parent == nullptr) {
+            parent = root;
+        }
+        StringRef internedName = names.intern(*arena, name);
+        auto found = scopeIndex.find(ChildKey{parent, internedName.data});
+        if (found != scopeIndex.end()) {
+            return found->second;
+        }
+        auto *scope = arena->create<Scope>();
+        scope->name = internedName;
+        scope->type = names.intern(*arena, type);
+        scope->parent = parent;
+        parent->scopes.push_back(scope);
+        scopeIndex.emplace(ChildKey{parent, internedName.data}, scope);
+        return scope;
+    }
+
+    Scope *VcdFile::findScope(const std::string &path) const {
+        Scope *scope = root;
+        size_t start = 0;
+        while (scope != nullptr && start < path.size()) {
+            size_t end = path.find('.', start);
+            if (end == std::string::npos) {
+                end = path.size();
+            }
+            const char *name = names.find(path.data() + start, end - start);
+            if (name == nullptr) {
+                return nullptr;
+            }
+            auto found = scopeIndex.find(ChildKey{scope, name});
+            scope = found != scopeIndex.end() ? found->second : nullptr;
+            start = end + 1;
+        }
+        return scope;
+    }
+
+    Variable *VcdFile::findVariable(const std::string &path) const {
+        size_t separator = path.rfind('.');
+        Scope *scope = separator == std::string::npos ? root : findScope(path.substr(0, separator));
+        size_t start = separator == std::string::npos ? 0 : separator + 1;
+        const char *name = names.find(path.data() + start, path.size() - start);
+        if (scope == nullptr || name == nullptr) {
+            return nullptr;
+        }
+        auto found = variableIndex.find(ChildKey{scope, name});
+        return found != variableIndex.end() ? found->second : nullptr;
+    }
+
+    std::string VcdFile::getPath(const Scope &scope) const {
+        std::vector<const Scope *> chain;
+        for (const Scope *it = &scope; it != root && it != nullptr; it = it->parent) {
+            chain.push_back(it);
+        }
+        std::string path;
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            if (!path.empty()) {
+                path += '.';
+            }
+            path.append((*it)->name.data, (*it)->name.length);
+        }
+        return path;
+    }
+
+    std::string VcdFile::getPath(const Variable &variable) const {
+        std::string path = variable.scope != nullptr ? getPath(*variable.scope) : std::string();
+        if (!path.empty()) {
+            path += '.';
+        }
+        path.append(variable.name.data, variable.name.length);
+        return path;
+    }
+
+    std::vector<Variable *> VcdFile::getVariables(const Scope &scope) const {
+        std::vector<Variable *> result;
+        std::vector<const Scope *> pending(1, &scope);
+        while (!pending.empty()) {
+            const Scope *it = pending.back();
+            pending.pop_back();
+            result.insert(result.end(), it->variables.begin(), it->variables.end());
+            // reversed, so that the first child is visited first
+            pending.insert(pending.end(), it->scopes.rbegin(), it->scopes.rend());
+        }
+        return result;
+    }
 }
 
 namespace VcdParser {
-    enum ParserStates {
-        InDefinitionCmds,
-        InSimulationCmds,
-
-        InComment,
-        InDate,
-        InEndDefinitions,
-        InScope,
-        InTimescale,
-        InUpscope,
-        InVar,
-        InVersion,
-
-        InDumpall,
-        InDumpoff,
-        InDumpon,
-        InDumpvars,
-
-        InVectorValueChange,
-    };
+    /**
+     * Parses the leading decimal digits of a token.
+     * @return the number of characters consumed, 0 if the token doesn't start with a digit or overflows.
+     */
+    static size_t parseNumber(const TokenView &str, uint64_t &result) {
+        return Utils::parseNumber(str.data, str.size, result);
+    }
+
+    /**
+     * Parses a real_number token, a decimal floating point number as printed by "%.16g".
+     * Numbers that can be converted exactly with one multiplication or division are handled
+     * here; the rest goes to strtod().
+     * @return false if the token isn't a number.
+     */
+    static bool parseReal(const TokenView &str, double &result) {
+        static const double powersOf10[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        size_t i = 0;
+        bool negative = false;
+        if (i < str.size && (str[i] == '-' || str[i] == '+')) {
+            negative = str[i] == '-';
+            i++;
+        }
+        uint64_t mantissa = 0;
+        int significantDigits = 0;
+        int exponent = 0;
+        bool hasDigits = false;
+        bool truncated = false;
+        bool fraction = false;
+        for (; i < str.size; i++) {
+            if (str[i] == '.' && !fraction) {
+                fraction = true;
+                continue;
+            }
+            unsigned digit = static_cast<unsigned char>(str[i]) - '0';
+            if (digit > 9) {
+                break;
+            }
+            hasDigits = true;
+            if (significantDigits < 19) {
+                mantissa = mantissa * 10 + digit;
+                significantDigits += mantissa != 0;
+                exponent -= fraction;
+            } else {
+                truncated |= digit != 0;
+                exponent += !fraction;
+            }
+        }
+        if (hasDigits && i < str.size && (str[i] == 'e' || str[i] == 'E')) {
+            i++;
+            bool negativeExponent = false;
+            if (i < str.size && (str[i] == '-' || str[i] == '+')) {
+                negativeExponent = str[i] == '-';
+                i++;
+            }
+            size_t start = i;
+            int value = 0;
+            for (; i < str.size && static_cast<unsigned>(str[i] - '0') <= 9; i++) {
+                value = std::min(value * 10 + (str[i] - '0'), 100000);
+            }
+            if (i == start) {
+                return false;
+            }
+            exponent += negativeExponent ? -value : value;
+        }
+        if (hasDigits && i != str.size) {
+            return false;
+        }
+        if (hasDigits && !truncated && mantissa <= (static_cast<uint64_t>(1) << 53)
+            && exponent >= -22 && exponent <= 22) {
+            auto value = static_cast<double>(mantissa);
+            value = exponent < 0 ? value / powersOf10[-exponent] : value * powersOf10[exponent];
+            result = negative ? -value : value;
+            return true;
+        }
+        // long mantissas, large exponents, inf and nan
+        char buffer[64];
+        std::string copy;
+        const char *text = buffer;
+        if (str.size < sizeof(buffer)) {
+            std::memcpy(buffer, str.data, str.size);
+            buffer[str.size] = '\0';
+        } else {
+            copy = str.toString();
+            text = copy.c_str();
+        }
+        char *end;
+        result = std::strtod(text, &end);
+        return str.size != 0 && end == text + str.size;
+    }
 
     enum class VarParseState {
         WaitVarType,
@@ -66,14 +352,10 @@ namespace VcdParser {
         Done
     };
 
-    struct Var {
-        VarType type = Wire; // var_type
-        int size = 0;
-        std::string identifier; // identifier_code
-        std::string name; // reference
+    struct Var : VarDefinition {
         VarParseState state = VarParseState::WaitVarType;
 
-        bool setVarType(const std::string &typeName) {
+        bool setVarType(const TokenView &typeName) {
             if (typeName == "reg") {
                 type = Reg;
             } else if (typeName == "wire") {
@@ -116,23 +398,23 @@ namespace VcdParser {
             return true;
         }
 
-        bool setSize(const std::string &sizeName) {
-            int s = std::stoi(sizeName);
-            if (s <= 0) {
+        bool setSize(const TokenView &sizeName) {
+            uint64_t s;
+            if (parseNumber(sizeName, s) != sizeName.size || s == 0 || s > INT32_MAX) {
                 return false;
             } else {
-                size = s;
+                size = static_cast<int>(s);
                 return true;
             }
         }
 
-        bool setIdentifier(const std::string &str) {
-            identifier = str;
+        bool setIdentifier(const TokenView &str) {
+            identifier.assign(str.data, str.size);
             return true;
         }
 
-        bool setName(const std::string &str) {
-            name = str;
+        bool setName(const TokenView &str) {
+            name.assign(str.data, str.size);
             return true;
         }
     };
@@ -148,17 +430,23 @@ namespace VcdParser {
         VcdFormat::TimeUnit timeUnit = VcdFormat::TimeUnit::unit_fs;
         TimescaleParseState state = TimescaleParseState::WaitTimeNumber;
 
-        bool setTimeNumber(const std::string &str) {
-            int s = std::stoi(str);
-            if (s <= 0) {
+        bool setTimeNumber(const TokenView &str) {
+            uint64_t s;
+            size_t len = parseNumber(str, s);
+            if (len == 0 || s == 0 || s > INT32_MAX) {
                 return false;
-            } else {
-                timeNumber = s;
+            }
+            timeNumber = static_cast<int>(s);
+            if (len == str.size) {
+                state = TimescaleParseState::WaitTimeUnit;
                 return true;
             }
+            // time_number and time_unit written without a space, e.g. "1ps"
+            state = TimescaleParseState::Done;
+            return setTimeUnit(str.substr(len));
         }
 
-        bool setTimeUnit(const std::string &str) {
+        bool setTimeUnit(const TokenView &str) {
             if (str == "s") {
                 timeUnit = VcdFormat::TimeUnit::unit_s;
             } else if (str == "ms") {
@@ -178,31 +466,223 @@ namespace VcdParser {
         }
     };
 
-    static inline bool checkVariableValue(char ch) {
-        return ch == '0' || ch == '1'
-               || ch == 'u' || ch == 'U'
-               || ch == 'x' || ch == 'X'
-               || ch == 'z' || ch == 'Z' || ch == '-';
+    /**
+     * Matches str against a pattern in which '*' matches any sequence of characters and '?' any
+     * single character.
+     */
+    static bool matchGlob(const char *pattern, const char *str) {
+        const char *starPattern = nullptr;
+        const char *starStr = nullptr;
+        while (*str != '\0') {
+            if (*pattern == '*') {
+                starPattern = ++pattern;
+                starStr = str;
+            } else if (*pattern == '?' || *pattern == *str) {
+                pattern++;
+                str++;
+            } else if (starPattern != nullptr) {
+                // let the last '*' consume one more character
+                pattern = starPattern;
+                str = ++starStr;
+            } else {
+                return false;
+            }
+        }
+        while (*pattern == '*') {
+            pattern++;
+        }
+        return *pattern == '\0';
+    }
+}
+
+void VcdParser::VcdFileBuilder::onHeader(const Header &header) {
+    vcdFile.date = header.date;
+    vcdFile.version = header.version;
+    vcdFile.timescale = header.timescale;
+}
+
+void VcdParser::VcdFileBuilder::onScope(uint32_t /*id*/, const ScopeDefinition &scope) {
+    Scope *parent = scope.parent == ScopeDefinition::Root ? nullptr : scopes[scope.parent];
+    scopes.push_back(vcdFile.createScope(scope.type, scope.name, parent));
+}
+
+void VcdParser::VcdFileBuilder::onVar(uint32_t /*id*/, const VarDefinition &var) {
+    Scope *scope = var.scope == ScopeDefinition::Root ? nullptr : scopes[var.scope];
+    Variable *variable = vcdFile.createVariable(var.name, var.identifier, scope);
+    variable->width = var.size;
+    variable->type = var.type;
+    if (variable->isReal()) {
+        // see Variable::realChanges
+    } else if (storageMode == StorageMode::PerBit) {
+        std::vector<SignalRecord> &signalLists = variable->signalLists;
+        signalLists.resize(var.size);
+        int i = 0;
+        for (auto &it : signalLists) {
+            it.index = i;
+            i++;
+        }
+    } else {
+        variable->changes.width = var.size;
+        variable->changes.stride = (var.size + 3) / 4;
+    }
+    variables.push_back(variable);
+}
+
+void VcdParser::VcdFileBuilder::onAlias(uint32_t id, const VarDefinition &var) {
+    Scope *scope = var.scope == ScopeDefinition::Root ? nullptr : scopes[var.scope];
+    Variable *variable = vcdFile.createVariable(var.name, var.identifier, scope);
+    // the changes are stored once, with the first variable of the identifier code
+    variable->aliasOf = variables[id];
+    variable->type = var.type;
+    variable->width = variables[id]->width;
+}
+
+void VcdParser::VcdFileBuilder::onScalarChange(uint32_t id, char value) {
+    Variable *variable = variables[id];
+    if (storageMode == StorageMode::PerBit) {
+        indexTime(); // changes before the first # record happen at time 0
+        variable->signalLists[0].values.push_back({currentTime, value});
+    } else {
+        *variable->changes.append(*vcdFile.arena, indexTime()) = toLogicState(value);
+    }
+}
+
+void VcdParser::VcdFileBuilder::onVectorChange(uint32_t id, const TokenView &value) {
+    Variable *variable = variables[id];
+    if (storageMode == StorageMode::PerBit) {
+        indexTime();
+        const char *valueIt = value.begin();
+        for (auto &it : variable->signalLists) {
+            it.values.push_back({currentTime, *valueIt});
+            valueIt++;
+        }
+    } else {
+        VectorChanges &changes = variable->changes;
+        VectorChanges::pack(changes.append(*vcdFile.arena, indexTime()), value.data, value.size);
     }
 }
 
+void VcdParser::VcdFileBuilder::onRealChange(uint32_t id, double value) {
+    indexTime();
+    variables[id]->realChanges.append(*vcdFile.arena, currentTime, value);
+}
+
+void VcdParser::VcdFileBuilder::onIndexedChange(uint32_t id, uint64_t offset) {
+    variables[id]->offsets.append(*vcdFile.arena, offset);
+    indexTime(); // changes before the first # record happen at time 0
+}
+
+void VcdParser::VcdFileBuilder::onFinish() {
+    vcdFile.lastVariableChangeTime = currentTime;
+}
+
+VcdParser::VcdParser::VcdParser()
+        : var(new Var()),
+          timescale(new Timescale()) {
+}
+
 VcdParser::VcdParser::VcdParser(const char *data, size_t len)
-        : tokenizer(data, len) {
+        : tokenizer(data, len),
+          input(data),
+          inputSize(len),
+          var(new Var()),
+          timescale(new Timescale()) {
+}
+
+VcdParser::VcdParser::VcdParser(InputSource &source)
+        : tokenizer(source.data(), source.size()),
+          input(source.data()),
+          inputSize(source.size()),
+          source(&source),
+          var(new Var()),
+          timescale(new Timescale()) {
+}
+
+VcdParser::VcdParser::VcdParser(const VcdParser &parent, VcdHandler &handler)
+        : handler(&handler),
+          state(InSimulationCmds),
+          savedState(InSimulationCmds),
+          var(new Var()),
+          timescale(new Timescale()),
+          identifierIndex(parent.identifierIndex),
+          varSizes(parent.varSizes),
+          varTypes(parent.varTypes),
+          definitionsDone(true) {
 }
 
+VcdParser::VcdParser::VcdParser(VcdParser &&) noexcept = default;
+
+VcdParser::VcdParser &VcdParser::VcdParser::operator=(VcdParser &&) noexcept = default;
+
+VcdParser::VcdParser::~VcdParser() = default;
+
 void VcdParser::VcdParser::parse() {
-    std::string token;
-    ParserStates state = InDefinitionCmds;
-    ParserStates savedState = state;
+    startStatsClock();
+    VCDPARSER_STAT(stats.bytes += inputSize);
+    windowed = windowed && input != nullptr;
+    indexOnly = handler == nullptr && builder.getStorageMode() == StorageMode::Indexed && input != nullptr
+                && !windowed;
+    if (indexOnly) {
+        builder.setInput(input, inputSize);
+    }
+    if (windowed) {
+        stopAtSimulation = true;
+        parseTokens();
+        stopAtSimulation = false;
+        if (state == InSimulationCmds) {
+            parseWindow();
+        }
+    } else if (threadCount > 1 && input != nullptr && !indexOnly) {
+        stopAtSimulation = true;
+        parseTokens();
+        stopAtSimulation = false;
+        if (state == InSimulationCmds) {
+            parseParallel();
+        }
+    } else {
+        parseTokens();
+    }
+    stopStatsClock();
+    getHandler()->onFinish();
+    collectMemoryStats();
+}
+
+void VcdParser::VcdParser::feed(const char *data, size_t len) {
+    startStatsClock();
+    VCDPARSER_STAT(stats.bytes += len);
+    tokenizer.feed(data, len);
+    parseTokens();
+    stopStatsClock();
+}
 
-    Var var;
-    Timescale timescale;
+void VcdParser::VcdParser::finish() {
+    startStatsClock();
+    tokenizer.finish();
+    parseTokens();
+    stopStatsClock();
+    getHandler()->onFinish();
+    collectMemoryStats();
+}
 
-    // vectorValueChangeType --binary/real
-    std::string vectorValueChangeValue;
+void VcdParser::VcdParser::parseStream(StreamSource &source) {
+    const char *data;
+    size_t size;
+    while (source.next(data, size)) {
+        feed(data, size);
+    }
+    finish();
+}
 
-    token = tokenizer.getNextToken();
+void VcdParser::VcdParser::parseTokens() {
+    Var &var = *this->var;
+    Timescale &timescale = *this->timescale;
+
+    TokenView token = tokenizer.getNextTokenView();
     while (!token.empty()) {
+        VCDPARSER_STAT(stats.tokens++);
+        if (source != nullptr && tokenizer.getOffset() >= nextReleaseOffset && state != InVectorValueChange) {
+            releaseInput(token);
+        }
         switch (state) {
             case InDefinitionCmds:
                 if (token == "$comment") {
@@ -214,6 +694,7 @@ void VcdParser::VcdParser::parse() {
                     state = InEndDefinitions;
                 } else if (token == "$scope") {
                     state = InScope;
+                    scopeTokens = 0;
                 } else if (token == "$timescale") {
                     state = InTimescale;
                     timescale.state = TimescaleParseState::WaitTimeNumber;
@@ -225,7 +706,7 @@ void VcdParser::VcdParser::parse() {
                 } else if (token == "$version") {
                     state = InVersion;
                 } else {
-                    throwException("Unknown token '%s'", token.c_str());
+                    throwException("Unknown token '%.*s'", (int) token.size, token.data);
                 }
                 break;
 
@@ -235,10 +716,23 @@ void VcdParser::VcdParser::parse() {
                 }
                 break;
 
-            case InScope:// Not implemented
+            case InScope:
+                if (token == "$end") {
+                    state = InDefinitionCmds;
+                    enterScope();
+                } else if (++scopeTokens == 1) { // scope_type scope_identifier
+                    scope.type.assign(token.data, token.size);
+                } else if (scopeTokens == 2) {
+                    scope.name.assign(token.data, token.size);
+                }
+                break;
+
             case InUpscope:
                 if (token == "$end") {
                     state = InDefinitionCmds;
+                    if (!scopeStack.empty()) {
+                        scopeStack.pop_back();
+                    }
                 } else {
                     // pass
                 }
@@ -248,18 +742,18 @@ void VcdParser::VcdParser::parse() {
                 if (token == "$end") {
                     state = InDefinitionCmds;
                 } else {
-                    std::string &v = vcdFile.date;
+                    std::string &v = header.date;
                     if (!v.empty()) {
                         v += " ";
                     }
-                    v += token;
+                    v.append(token.data, token.size);
                 }
                 break;
 
             case InTimescale:
                 if (token == "$end") {
-                    vcdFile.timescale.timeNumber = timescale.timeNumber;
-                    vcdFile.timescale.timeUnit = timescale.timeUnit;
+                    header.timescale.timeNumber = timescale.timeNumber;
+                    header.timescale.timeUnit = timescale.timeUnit;
                     state = InDefinitionCmds;
                 } else {
                     switch (timescale.state) {
@@ -267,7 +761,6 @@ void VcdParser::VcdParser::parse() {
                             if (!timescale.setTimeNumber(token)) {
                                 throwException("time_number of variable is invalid");
                             }
-                            timescale.state = TimescaleParseState::WaitTimeUnit;
                             break;
                         case TimescaleParseState::WaitTimeUnit:
                             if (!timescale.setTimeUnit(token)) {
@@ -285,16 +778,10 @@ void VcdParser::VcdParser::parse() {
             case InVar:
                 if (token == "$end") {
                     state = InDefinitionCmds;
-                    // new variable
-                    Variable *variable = vcdFile.createVariable(var.name, var.identifier);
-                    std::vector<SignalRecord> &signalLists = variable->signalLists;
-                    signalLists.resize(var.size);
-                    int i = 0;
-                    for (auto &it : signalLists) {
-                        it.index = i;
-                        i++;
-                    }
-                    varIdentifierMap[var.identifier] = variable;
+                    // new variable, defined at $enddefinitions
+                    var.scope = scopeStack.empty() ? ScopeDefinition::Root : scopeStack.back();
+                    definitions.push_back(var);
+                    definitionSelected.push_back(isSelected(var));
                 } else {
                     switch (var.state) {
                         case VarParseState::WaitVarType:
@@ -332,11 +819,11 @@ void VcdParser::VcdParser::parse() {
                 if (token == "$end") {
                     state = InDefinitionCmds;
                 } else {
-                    std::string &v = vcdFile.version;
+                    std::string &v = header.version;
                     if (!v.empty()) {
                         v += " ";
                     }
-                    v += token;
+                    v.append(token.data, token.size);
                 }
                 break;
 
@@ -345,6 +832,14 @@ void VcdParser::VcdParser::parse() {
                     // eNd dEfInItIoNs
                     state = InSimulationCmds;
                     savedState = state;
+                    stopStatsClock();
+                    definitionsDone = true;
+                    startStatsClock();
+                    getHandler()->onHeader(header);
+                    defineVariables();
+                    if (stopAtSimulation) {
+                        return;
+                    }
                 }
                 break;
 
@@ -356,23 +851,35 @@ void VcdParser::VcdParser::parse() {
                 switch (token[0]) {
                     case 'b':
                     case 'B':
+                    case 'r':
+                    case 'R':
                         // vector_value_change
                         vectorValueChangeValue = token.substr(1);
+                        vectorValueOffset = tokenizer.getLastOffset();
+                        vectorValueReal = token[0] == 'r' || token[0] == 'R';
+                        vectorValueBuffered = tokenizer.isStreaming();
+                        if (vectorValueBuffered) {
+                            // the view doesn't survive the next chunk
+                            vectorValueBuffer.assign(vectorValueChangeValue.data, vectorValueChangeValue.size);
+                        }
                         state = InVectorValueChange;
                         break;
 
-                    case 'r':
-                    case 'R':
-                        throwException("real_number is not supported in vector_value_change");
-                        break;
-
                     case '#': {
-                        auto timeStr = token.substr(1);
-                        unsigned long long s = std::stoul(timeStr);
-                        if (s < 0) {
-                            throwException("invalid simulation time '%s'", timeStr.c_str());
+                        TokenView timeStr = token.substr(1);
+                        uint64_t s;
+                        if (timeStr.empty() || parseNumber(timeStr, s) != timeStr.size) {
+                            throwException("invalid simulation time '%.*s'", (int) timeStr.size, timeStr.data);
                         } else {
+                            if (s > timeLimit) {
+                                return;
+                            }
                             currentTime = s;
+                            VCDPARSER_STAT(stats.timeRecords++);
+                            if (indexOnly) {
+                                builder.setTimeOffset(tokenizer.getLastOffset());
+                            }
+                            getHandler()->onTime(s);
                         }
                         break;
                     }
@@ -384,24 +891,33 @@ void VcdParser::VcdParser::parse() {
                         } else if (token == "$dumpall") {
                             state = InDumpall;
                             savedState = state; // InDumpall
+                            VCDPARSER_STAT(stats.dumpSections++);
+                            getHandler()->onDumpSection(DumpSection::Dumpall);
                         } else if (token == "$dumpoff") {
                             state = InDumpoff;
                             savedState = state; // InDumpoff
+                            VCDPARSER_STAT(stats.dumpSections++);
+                            getHandler()->onDumpSection(DumpSection::Dumpoff);
                         } else if (token == "$dumpon") {
                             state = InDumpon;
                             savedState = state; // InDumpon
+                            VCDPARSER_STAT(stats.dumpSections++);
+                            getHandler()->onDumpSection(DumpSection::Dumpon);
                         } else if (token == "$dumpvars") {
                             state = InDumpvars;
                             savedState = state; // InDumpvars
+                            VCDPARSER_STAT(stats.dumpSections++);
+                            getHandler()->onDumpSection(DumpSection::Dumpvars);
                         } else if (token == "$end") {
                             if (state == InSimulationCmds) {
                                 throwException("unexpected token $end");
                             } else {
+                                getHandler()->onDumpSectionEnd(getDumpSection(state));
                                 state = InSimulationCmds;
                                 savedState = state; // InSimulationCmds
                             }
                         } else {
-                            throwException("unknown token '%s'", token.c_str());
+                            throwException("unknown token '%.*s'", (int) token.size, token.data);
                         }
                         break;
 
@@ -413,57 +929,251 @@ void VcdParser::VcdParser::parse() {
             }
 
             case InVectorValueChange: {
-                parseVectorValueChange(token, vectorValueChangeValue);
+                if (vectorValueBuffered) {
+                    vectorValueChangeValue = TokenView(vectorValueBuffer.data(), vectorValueBuffer.size());
+                }
+                if (vectorValueReal) {
+                    parseRealValueChange(token, vectorValueChangeValue);
+                } else {
+                    parseVectorValueChange(token, vectorValueChangeValue);
+                }
                 state = savedState;
                 break;
             }
             default:
                 return;
         }
-        token = tokenizer.getNextToken();
+        token = tokenizer.getNextTokenView();
     }
-    vcdFile.lastVariableChangeTime = currentTime;
 }
 
-void VcdParser::VcdParser::parseScalarValueChange(const std::string &definition) {
-    if (definition.length() <= 1) {
+void VcdParser::VcdParser::parseScalarValueChange(const TokenView &definition) {
+    if (definition.size <= 1) {
         throwException("invalid scalar value change definition");
     }
-    std::string identifier = definition.substr(1);
-    auto mapIt = varIdentifierMap.find(identifier);
-    if (mapIt == varIdentifierMap.end()) {
-        throwException("invalid scalar value change definition: identifier '%s' is not defined", identifier.c_str());
+    TokenView identifier = definition.substr(1);
+    uint32_t id = identifierIndex.find(identifier);
+    VCDPARSER_STAT(stats.hashedLookups += !identifierIndex.isDense(identifier));
+    if (id >= SkippedId) {
+        if (id == SkippedId) {
+            VCDPARSER_STAT(stats.skippedChanges++);
+            return;
+        }
+        throwException("invalid scalar value change definition: identifier '%.*s' is not defined",
+                       (int) identifier.size, identifier.data);
+    }
+    if (varSizes[id] != 1) {
+        throwException("invalid scalar value change definition: variable '%.*s' is not a scalar",
+                       (int) identifier.size, identifier.data);
     }
-    Variable *var = varIdentifierMap[identifier];
-    if (var->signalLists.size() != 1) {
-        throwException("invalid scalar value change definition: variable '%s' is not a scalar", identifier.c_str());
+    if (varTypes[id] == Real || varTypes[id] == Realtime) {
+        throwException("invalid scalar value change definition: variable '%.*s' is real",
+                       (int) identifier.size, identifier.data);
+    }
+    VCDPARSER_STAT(stats.scalarChanges++; stats.variableChanges[id]++);
+    if (indexOnly) { // the value is checked by VcdFile::load()
+        builder.onIndexedChange(id, tokenizer.getLastOffset());
+        return;
     }
     char value = definition[0];
-    if (!checkVariableValue(value)) {
+    if (!Simd::isValueChar(value)) {
         throwException("invalid scalar value change definition: value %c is invalid", value);
     }
-    var->signalLists[0].values.push_back({currentTime, value});
+    getHandler()->onScalarChange(id, value);
+}
+
+void VcdParser::VcdParser::parseVectorValueChange(const TokenView &identifier, const TokenView &value) {
+    uint32_t id = identifierIndex.find(identifier);
+    VCDPARSER_STAT(stats.hashedLookups += !identifierIndex.isDense(identifier));
+    if (id >= SkippedId) {
+        if (id == SkippedId) {
+            VCDPARSER_STAT(stats.skippedChanges++);
+            return;
+        }
+        throwException("invalid vector value change definition: identifier '%.*s' is not defined",
+                       (int) identifier.size, identifier.data);
+    }
+    if (varTypes[id] == Real || varTypes[id] == Realtime) {
+        throwException("invalid vector value change definition: variable '%.*s' is real",
+                       (int) identifier.size, identifier.data);
+    }
+    VCDPARSER_STAT(stats.vectorChanges++; stats.variableChanges[id]++);
+    if (indexOnly) {
+        builder.onIndexedChange(id, vectorValueOffset);
+        return;
+    }
+    uint64_t varSize = varSizes[id];
+    if (value.size > varSize || value.empty()) {
+        throwException("invalid vector value change definition: unexpected value size %d", (int) value.size);
+    }
+    const char *invalid = findInvalidValue(value.begin(), value.end());
+    if (invalid != value.end()) {
+        throwException("invalid vector value change definition: value %c is invalid", *invalid);
+    }
+    if (value.size == varSize) {
+        getHandler()->onVectorChange(id, value);
+        return;
+    }
+    // left-extend with 0 if the leftmost bit is 0 or 1, or with the leftmost bit otherwise
+    char fill = value[0] == '1' ? '0' : value[0];
+    extendedValue.assign(varSize - value.size, fill);
+    extendedValue.append(value.data, value.size);
+    getHandler()->onVectorChange(id, TokenView(extendedValue.data(), extendedValue.size()));
+}
+
+void VcdParser::VcdParser::parseRealValueChange(const TokenView &identifier, const TokenView &value) {
+    uint32_t id = identifierIndex.find(identifier);
+    VCDPARSER_STAT(stats.hashedLookups += !identifierIndex.isDense(identifier));
+    if (id >= SkippedId) {
+        if (id == SkippedId) {
+            VCDPARSER_STAT(stats.skippedChanges++);
+            return;
+        }
+        throwException("invalid real value change definition: identifier '%.*s' is not defined",
+                       (int) identifier.size, identifier.data);
+    }
+    if (varTypes[id] != Real && varTypes[id] != Realtime) {
+        throwException("invalid real value change definition: variable '%.*s' is not real",
+                       (int) identifier.size, identifier.data);
+    }
+    double number;
+    if (!parseReal(value, number)) {
+        throwException("invalid real value change definition: value '%.*s' is invalid",
+                       (int) value.size, value.data);
+    }
+    VCDPARSER_STAT(stats.realChanges++; stats.variableChanges[id]++);
+    getHandler()->onRealChange(id, number);
+}
+
+void VcdParser::VcdParser::selectByName(const std::string &pattern) {
+    namePatterns.push_back(pattern);
+}
+
+void VcdParser::VcdParser::selectByIdentifier(const std::string &identifierCode) {
+    selectedIdentifiers.push_back(identifierCode);
 }
 
-void VcdParser::VcdParser::parseVectorValueChange(const std::string &identifier, const std::string &value) {
-    auto mapIt = varIdentifierMap.find(identifier);
-    if (mapIt == varIdentifierMap.end()) {
-        throwException("invalid vector value change definition: identifier '%s' is not defined", identifier.c_str());
+VcdParser::DumpSection VcdParser::VcdParser::getDumpSection(ParserStates state) {
+    switch (state) {
+        case InDumpall:
+            return DumpSection::Dumpall;
+        case InDumpoff:
+            return DumpSection::Dumpoff;
+        case InDumpon:
+            return DumpSection::Dumpon;
+        default:
+            return DumpSection::Dumpvars;
     }
-    Variable *var = varIdentifierMap[identifier];
-    uint64_t varSize = var->signalLists.size();
-    if (value.length() != varSize) {
-        throwException("invalid vector value change definition: unexpected value size %d", value.length());
+}
+
+bool VcdParser::VcdParser::isSelected(const VarDefinition &var) const {
+    if (namePatterns.empty() && selectedIdentifiers.empty()) {
+        return true;
     }
-    auto valueIt = value.begin();
-    for (auto &it : var->signalLists) {
-        char v = *valueIt;
-        if (!checkVariableValue(v)) {
-            throwException("invalid vector value change definition: value %c is invalid", v);
+    for (const auto &it : selectedIdentifiers) {
+        if (it == var.identifier) {
+            return true;
         }
-        it.values.push_back({currentTime, v});
-        valueIt++;
     }
+    if (namePatterns.empty()) {
+        return false;
+    }
+    std::string path = var.name;
+    for (uint32_t it = var.scope; it != ScopeDefinition::Root; it = scopes[it].parent) {
+        path.insert(0, scopes[it].name + '.');
+    }
+    for (const auto &it : namePatterns) {
+        if (matchGlob(it.c_str(), path.c_str())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void VcdParser::VcdParser::enterScope() {
+    scope.parent = scopeStack.empty() ? ScopeDefinition::Root : scopeStack.back();
+    std::string key = std::to_string(scope.parent) + '.' + scope.name;
+    auto found = scopeIds.find(key);
+    if (found != scopeIds.end()) {
+        scopeStack.push_back(found->second);
+        return;
+    }
+    auto id = static_cast<uint32_t>(scopes.size());
+    scopes.push_back(scope);
+    scopeIds.emplace(key, id);
+    scopeStack.push_back(id);
+}
+
+void VcdParser::VcdParser::defineVariables() {
+    for (size_t i = 0; i < scopes.size(); i++) {
+        getHandler()->onScope(static_cast<uint32_t>(i), scopes[i]);
+    }
+    for (size_t i = 0; i < definitions.size(); i++) {
+        const VarDefinition &var = definitions[i];
+        TokenView identifier(var.identifier.data(), var.identifier.size());
+        if (definitionSelected[i]) {
+            uint32_t id = identifierIndex.find(identifier);
+            if (id < SkippedId) {
+                getHandler()->onAlias(id, var);
+                continue;
+            }
+            id = static_cast<uint32_t>(varSizes.size());
+            varSizes.push_back(var.size);
+            varTypes.push_back(var.type);
+            identifierIndex.insert(identifier, id);
+            getHandler()->onVar(id, var);
+        } else if (identifierIndex.find(identifier) == IdentifierIndex::NotFound) {
+            identifierIndex.insert(identifier, SkippedId);
+        }
+    }
+    identifierIndex.build();
+    VCDPARSER_STAT(stats.variableChanges.resize(varSizes.size()));
+    definitions.clear();
+    definitions.shrink_to_fit();
+    definitionSelected.clear();
+    definitionSelected.shrink_to_fit();
+    scopes.clear();
+    scopes.shrink_to_fit();
+    scopeIds.clear();
+}
+
+void VcdParser::VcdParser::releaseInput(const TokenView &token) {
+    // everything before the current token has been consumed
+    size_t offset = token.data - source->data();
+    source->release(offset);
+    nextReleaseOffset = offset + ReleaseInterval;
+}
+
+void VcdParser::VcdParser::startStatsClock() {
+#ifdef VCDPARSER_ENABLE_STATS
+    statsClock = std::chrono::steady_clock::now();
+#endif
+}
+
+void VcdParser::VcdParser::stopStatsClock() {
+#ifdef VCDPARSER_ENABLE_STATS
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsClock).count();
+    (definitionsDone ? stats.simulationSeconds : stats.definitionsSeconds) += seconds;
+#endif
+}
+
+void VcdParser::VcdParser::collectMemoryStats() {
+#ifdef VCDPARSER_ENABLE_STATS
+    stats.identifierIndexBytes = identifierIndex.getMemoryUsage();
+    if (handler != nullptr) {
+        return;
+    }
+    const VcdFile &file = builder.getResult();
+    stats.arenaBytes = file.arena->getAllocatedBytes();
+    stats.timestampBytes = (file.timestamps.capacity() + file.timeOffsets.capacity()) * sizeof(uint64_t);
+    stats.signalListBytes = 0;
+    for (const Variable *variable : file.variableList) {
+        stats.signalListBytes += variable->signalLists.capacity() * sizeof(SignalRecord);
+        for (const SignalRecord &list : variable->signalLists) {
+            stats.signalListBytes += list.values.capacity() * sizeof(ValueChange);
+        }
+    }
+#endif
 }
 
 void VcdParser::VcdParser::throwException(const char *fmt, ...) {
@@ -3,11 +3,18 @@
 #pragma once
 
 #include <iostream>
+#include <chrono>
 #include <cstdint>
 #include <utility>
 #include <vector>
-#include <map>
+#include <memory>
+#include <unordered_map>
 
+#include "arena.h"
+#include "identifier_index.h"
+#include "input_source.h"
+#include "simd.h"
+#include "stats.h"
 #include "tokenizer.h"
 
 namespace VcdFormat {
@@ -52,20 +59,269 @@ namespace VcdFormat {
     };
 
 
+    struct Header {
+        std::string date;
+        std::string version;
+        Timescale timescale;
+    };
+
     struct ValueChange {
         uint64_t time;
         char data; // 'U', 'Z', '0', '1';
     };
 
+    struct RealValueChange {
+        uint64_t time;
+        double value;
+    };
+
     struct SignalRecord {
         unsigned int index = 0;//represent the order in the bus signal
         std::vector<ValueChange> values;
     };
 
+    enum class StorageMode {
+        PerBit, // one SignalRecord per bit, see Variable::signalLists
+        Packed, // one record per change of the whole variable, see Variable::changes
+        Indexed // only where the changes are in the input, see VcdFile::load()
+    };
+
+    /**
+     * Value changes of a variable, one record per change: the time and the packed
+     * 4-state value, 2 bits per bit with bit 0 (the least significant bit, i.e. the
+     * last character of the value) in the lowest bits of the first byte.
+     *
+     * Times are stored as indices into VcdFile::timestamps, each encoded as a LEB128
+     * varint of the difference to the index of the previous change. Use
+     * VcdFile::getChanges() to iterate over the changes with their times.
+     */
+    struct VectorChanges {
+        unsigned int width = 0;
+        unsigned int stride = 0; // bytes per value
+        size_t count = 0;
+        uint64_t lastTimeIndex = 0;
+        ByteBuffer timeDeltas;
+        ByteBuffer states;
+
+        size_t size() const {
+            return count;
+        }
+
+        /**
+         * Adds a change with all bits 0 and returns its state bytes.
+         */
+        uint8_t *append(Arena &arena, uint64_t timeIndex);
+
+        /**
+         * @param bit bit index, 0 is the least significant bit
+         */
+        LogicState getBit(size_t change, unsigned int bit) const {
+            return static_cast<LogicState>((states[change * stride + bit / 4] >> (bit % 4 * 2)) & 3);
+        }
+
+        /**
+         * The value of a change as a string, most significant bit first.
+         */
+        std::string getValue(size_t change) const;
+
+        /**
+         * Packs value, most significant bit first, into the state bytes of a change.
+         */
+        static void pack(uint8_t *states, const char *value, size_t length);
+    };
+
+    /**
+     * Changes of a real variable as RealValueChange records, in every storage mode.
+     */
+    struct RealChanges {
+        ByteBuffer records;
+
+        size_t size() const {
+            return records.size / sizeof(RealValueChange);
+        }
+
+        bool empty() const {
+            return records.empty();
+        }
+
+        const RealValueChange *begin() const {
+            return reinterpret_cast<const RealValueChange *>(records.data);
+        }
+
+        const RealValueChange *end() const {
+            return begin() + size();
+        }
+
+        const RealValueChange &operator[](size_t i) const {
+            return begin()[i];
+        }
+
+        void append(Arena &arena, uint64_t time, double value) {
+            RealValueChange change = {time, value};
+            std::memcpy(records.grow(arena, sizeof(change)), &change, sizeof(change));
+        }
+    };
+
+    /**
+     * Input offsets of the value changes of a variable that haven't been decoded yet,
+     * each encoded as a LEB128 varint of the difference to the previous offset.
+     */
+    struct ChangeOffsets {
+        size_t count = 0;
+        uint64_t lastOffset = 0;
+        ByteBuffer deltas;
+
+        void append(Arena &arena, uint64_t offset);
+    };
+
+    class VcdQuery;
+    class DetailPyramid;
+
+    /**
+     * Iterates over VectorChanges, decoding the time of each change.
+     */
+    class ChangeIterator {
+        friend class VcdQuery;
+        friend class DetailPyramid;
+
+        const VectorChanges *changes;
+        const uint64_t *timestamps;
+        size_t changeIndex;
+        size_t deltaOffset = 0;
+        uint64_t timeIdx = 0;
+
+        // resumes at a change whose time has been decoded before, see VcdQuery and DetailPyramid
+        ChangeIterator(const VectorChanges &changes, const uint64_t *timestamps, size_t changeIndex,
+                       uint64_t timeIndex, size_t nextDeltaOffset)
+                : changes(&changes), timestamps(timestamps), changeIndex(changeIndex),
+                  deltaOffset(nextDeltaOffset), timeIdx(timeIndex) {
+        }
+
+        void decodeTime() {
+            uint64_t delta = 0;
+            unsigned int shift = 0;
+            uint8_t byte;
+            do {
+                byte = changes->timeDeltas[deltaOffset++];
+                delta |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            timeIdx += delta;
+        }
+
+    public:
+        ChangeIterator(const VectorChanges &changes, const uint64_t *timestamps, size_t changeIndex)
+                : changes(&changes), timestamps(timestamps), changeIndex(changeIndex) {
+            if (changeIndex < changes.count) {
+                decodeTime();
+            }
+        }
+
+        size_t index() const {
+            return changeIndex;
+        }
+
+        uint64_t timeIndex() const {
+            return timeIdx;
+        }
+
+        uint64_t time() const {
+            return timestamps[timeIdx];
+        }
+
+        /**
+         * @param bit bit index, 0 is the least significant bit
+         */
+        LogicState getBit(unsigned int bit) const {
+            return changes->getBit(changeIndex, bit);
+        }
+
+        const uint8_t *states() const {
+            return changes->states.data + changeIndex * changes->stride;
+        }
+
+        std::string getValue() const {
+            return changes->getValue(changeIndex);
+        }
+
+        const ChangeIterator &operator*() const {
+            return *this;
+        }
+
+        ChangeIterator &operator++() {
+            if (++changeIndex < changes->count) {
+                decodeTime();
+            }
+            return *this;
+        }
+
+        bool operator==(const ChangeIterator &other) const {
+            return changeIndex == other.changeIndex;
+        }
+
+        bool operator!=(const ChangeIterator &other) const {
+            return changeIndex != other.changeIndex;
+        }
+    };
+
+    struct ChangeRange {
+        ChangeIterator first;
+        ChangeIterator last;
+
+        ChangeIterator begin() const {
+            return first;
+        }
+
+        ChangeIterator end() const {
+            return last;
+        }
+    };
+
+    struct Scope;
+
     struct Variable {
-        std::string name;
-        std::string identifier;
-        std::vector<SignalRecord> signalLists;
+        StringRef name; // reference, without the scopes
+        StringRef identifier;
+        Scope *scope = nullptr;
+        unsigned int width = 0;
+        VarType type = Wire; // as declared
+        std::vector<SignalRecord> signalLists; // StorageMode::PerBit
+        VectorChanges changes; // StorageMode::Packed, and Indexed once loaded
+        ChangeOffsets offsets; // StorageMode::Indexed, until loaded
+        RealChanges realChanges; // real variables
+        // set if the identifier code was declared before, by the variable holding the
+        // changes of both; the change fields of an alias stay empty
+        Variable *aliasOf = nullptr;
+
+        /**
+         * Whether the changes are in realChanges rather than in signalLists or changes.
+         */
+        bool isReal() const {
+            return type == Real || type == Realtime;
+        }
+
+        /**
+         * The variable holding the changes: this one, or the one it's an alias of.
+         */
+        const Variable &getCanonical() const {
+            return aliasOf == nullptr ? *this : *aliasOf;
+        }
+
+        Variable &getCanonical() {
+            return aliasOf == nullptr ? *this : *aliasOf;
+        }
+    };
+
+    /**
+     * A $scope of the definitions section. The scopes of a file form a tree below
+     * VcdFile::root, which holds the variables declared outside of any scope.
+     */
+    struct Scope {
+        StringRef name; // interned, see VcdFile::names
+        StringRef type; // scope_type, e.g. "module"
+        Scope *parent = nullptr; // nullptr for the root
+        std::vector<Scope *> scopes;
+        std::vector<Variable *> variables;
     };
 
     struct VcdFile {
@@ -78,9 +334,115 @@ namespace VcdFormat {
         std::vector<Variable *> variableList;
         // std::vector<SignalRecord *> signalList;
 
+        // distinct simulation times in the order of their # records, shared by all variables
+        std::vector<uint64_t> timestamps;
+
+        // StorageMode::Indexed: the parsed input, and the input offset of the # record of
+        // each timestamp; the input is borrowed and must outlive the file
+        const char *input = nullptr;
+        size_t inputSize = 0;
+        std::vector<uint64_t> timeOffsets;
+
+        // owns the variables, their names and packed change buffers
+        std::unique_ptr<Arena> arena;
+        // cache file the names and change buffers point into, if loaded with Cache::load()
+        std::unique_ptr<VcdParser::InputSource> mapping;
+
+        Scope *root = nullptr;
+        // names of scopes and variables
+        StringPool names;
+
+        // children of each scope by their interned name, for findScope() and findVariable()
+        struct ChildKey {
+            const Scope *parent;
+            const char *name;
+
+            bool operator==(const ChildKey &other) const {
+                return parent == other.parent && name == other.name;
+            }
+        };
+
+        struct ChildKeyHash {
+            size_t operator()(const ChildKey &key) const {
+                return std::hash<const void *>()(key.parent) * 31 + std::hash<const void *>()(key.name);
+            }
+        };
+
+        std::unordered_map<ChildKey, Scope *, ChildKeyHash> scopeIndex;
+        std::unordered_map<ChildKey, Variable *, ChildKeyHash> variableIndex;
+
+        VcdFile();
+
+        VcdFile(const VcdFile &) = delete;
+
+        VcdFile(VcdFile &&) noexcept;
+
+        VcdFile &operator=(const VcdFile &) = delete;
+
+        VcdFile &operator=(VcdFile &&) noexcept;
+
         ~VcdFile();
 
-        Variable *createVariable(std::string name, std::string identifier);
+        /**
+         * @param scope the scope declaring the variable, nullptr for the root
+         */
+        Variable *createVariable(const std::string &name, const std::string &identifier, Scope *scope = nullptr);
+
+        /**
+         * Creates a scope, or returns the existing child of parent with that name: a scope
+         * may be entered again later in the definitions section.
+         * @param parent nullptr for the root
+         */
+        Scope *createScope(const std::string &type, const std::string &name, Scope *parent = nullptr);
+
+        /**
+         * Looks up a scope by its path, the names of the scopes from the root joined by '.'
+         * ("top.cpu.alu"); the empty path is the root.
+         * @return nullptr if there's no such scope
+         */
+        Scope *findScope(const std::string &path) const;
+
+        /**
+         * Looks up a variable by its path, the names of its scopes and its reference
+         * joined by '.' ("top.cpu.alu.a"). If several variables have the same path,
+         * the first one is returned.
+         * @return nullptr if there's no such variable
+         */
+        Variable *findVariable(const std::string &path) const;
+
+        std::string getPath(const Scope &scope) const;
+
+        std::string getPath(const Variable &variable) const;
+
+        /**
+         * Variables of scope and all scopes below it, depth first: the variables of a scope
+         * come before those of its child scopes.
+         */
+        std::vector<Variable *> getVariables(const Scope &scope) const;
+
+        /**
+         * Decodes the changes of a variable parsed with StorageMode::Indexed from the input,
+         * storing them in Variable::changes as StorageMode::Packed would have. Does nothing
+         * if the variable has no changes waiting to be decoded.
+         * @throw VcdParser::VcdException if a value is invalid, which wasn't checked while indexing,
+         * with the line and column the parser would have reported.
+         */
+        void load(Variable &variable);
+
+        /**
+         * Changes of a variable stored with StorageMode::Packed, or loaded with load().
+         */
+        ChangeRange getChanges(const Variable &variable) const {
+            const VectorChanges &changes = variable.getCanonical().changes;
+            return {ChangeIterator(changes, timestamps.data(), 0),
+                    ChangeIterator(changes, timestamps.data(), changes.count)};
+        }
+
+        /**
+         * Changes of one bit, in the format of SignalRecord::values regardless of the storage mode.
+         * @param index index of the bit as in signalLists, 0 is the most significant bit
+         */
+        std::vector<ValueChange> getBitChanges(const Variable &variable, unsigned int index) const;
 
         // SignalRecord *createSignal();
     };
@@ -97,30 +459,418 @@ namespace VcdParser {
         };
     };
 
+    struct ScopeDefinition {
+        // parent of the scopes and variables declared outside of any scope
+        static const uint32_t Root = UINT32_MAX;
+
+        std::string type; // scope_type
+        std::string name; // scope_identifier
+        uint32_t parent = Root;
+    };
+
+    struct VarDefinition {
+        VcdFormat::VarType type = VcdFormat::Wire; // var_type
+        int size = 0;
+        std::string identifier; // identifier_code
+        std::string name; // reference
+        uint32_t scope = ScopeDefinition::Root;
+    };
+
+    enum class DumpSection {
+        Dumpall,
+        Dumpoff,
+        Dumpon,
+        Dumpvars
+    };
+
+    /**
+     * Receives the contents of a VCD file while it is being parsed.
+     *
+     * Variables are referred to by an id assigned in onVar(), and scopes by an id assigned
+     * in onScope(); both are dense and start at 0.
+     * Values passed to the handler have been validated. Views are only valid during the call.
+     */
+    class VcdHandler {
+    public:
+        virtual ~VcdHandler() = default;
+
+        /**
+         * Called at $enddefinitions with the header commands seen in the definitions section,
+         * before the scopes and variables.
+         */
+        virtual void onHeader(const VcdFormat::Header &/*header*/) {
+        }
+
+        /**
+         * Called at $enddefinitions for every scope, before the variables and with parents
+         * before their children. A scope entered several times is reported once.
+         */
+        virtual void onScope(uint32_t /*id*/, const ScopeDefinition &/*scope*/) {
+        }
+
+        /**
+         * Called at $enddefinitions for every selected identifier code, with the first
+         * variable declared with it. Ids are assigned in that order, starting at 0.
+         */
+        virtual void onVar(uint32_t /*id*/, const VarDefinition &/*var*/) {
+        }
+
+        /**
+         * Called for every further selected variable declared with the identifier code of
+         * variable id, e.g. a port connected across hierarchy levels. Its changes are those
+         * reported for id.
+         */
+        virtual void onAlias(uint32_t /*id*/, const VarDefinition &/*var*/) {
+        }
+
+        virtual void onTime(uint64_t /*time*/) {
+        }
+
+        virtual void onDumpSection(DumpSection /*section*/) {
+        }
+
+        virtual void onDumpSectionEnd(DumpSection /*section*/) {
+        }
+
+        virtual void onScalarChange(uint32_t /*id*/, char /*value*/) {
+        }
+
+        /**
+         * @param value one character per bit, most significant bit first. Values shorter
+         * than the variable have already been left-extended.
+         */
+        virtual void onVectorChange(uint32_t /*id*/, const TokenView &/*value*/) {
+        }
+
+        virtual void onRealChange(uint32_t /*id*/, double /*value*/) {
+        }
+
+        /**
+         * Called once the whole input has been parsed.
+         */
+        virtual void onFinish() {
+        }
+    };
+
+    /**
+     * Handler that stores the parsed contents in a VcdFile.
+     */
+    class VcdFileBuilder : public VcdHandler {
+        VcdFormat::VcdFile vcdFile;
+        std::vector<VcdFormat::Variable *> variables;
+        std::vector<VcdFormat::Scope *> scopes;
+        uint64_t currentTime = 0;
+        // whether currentTime has been added to VcdFile::timestamps
+        bool timeIndexed = false;
+        VcdFormat::StorageMode storageMode = VcdFormat::StorageMode::PerBit;
+        // StorageMode::Indexed: offset of the last # record
+        uint64_t timeOffset = 0;
+    public:
+        VcdFormat::VcdFile &getResult() {
+            return vcdFile;
+        }
+
+        /**
+         * Selects how value changes are stored; must be set before parsing starts.
+         */
+        void setStorageMode(VcdFormat::StorageMode mode) {
+            storageMode = mode;
+        }
+
+        VcdFormat::StorageMode getStorageMode() const {
+            return storageMode;
+        }
+
+        /**
+         * With StorageMode::Indexed, the parser reports where the changes are in input instead
+         * of their values. Without the whole input, i.e. with feed(), values are reported and
+         * stored as with StorageMode::Packed.
+         */
+        void setInput(const char *data, size_t size) {
+            vcdFile.input = data;
+            vcdFile.inputSize = size;
+        }
+
+        void setTimeOffset(uint64_t offset) {
+            timeOffset = offset;
+        }
+
+        void onIndexedChange(uint32_t id, uint64_t offset);
+
+        void onHeader(const VcdFormat::Header &header) override;
+
+        void onScope(uint32_t id, const ScopeDefinition &scope) override;
+
+        void onVar(uint32_t id, const VarDefinition &var) override;
+
+        void onAlias(uint32_t id, const VarDefinition &var) override;
+
+        void onTime(uint64_t time) override {
+            currentTime = time;
+            timeIndexed = false;
+            indexTime(); // every # record gets an entry, even without changes
+        }
+
+        void onScalarChange(uint32_t id, char value) override;
+
+        void onVectorChange(uint32_t id, const TokenView &value) override;
+
+        void onRealChange(uint32_t id, double value) override;
+
+        void onFinish() override;
+
+    private:
+        uint64_t indexTime() {
+            std::vector<uint64_t> &timestamps = vcdFile.timestamps;
+            if (!timeIndexed) {
+                if (timestamps.empty() || timestamps.back() != currentTime) {
+                    timestamps.push_back(currentTime);
+                    if (storageMode == VcdFormat::StorageMode::Indexed) {
+                        vcdFile.timeOffsets.push_back(timeOffset);
+                    }
+                }
+                timeIndexed = true;
+            }
+            return timestamps.size() - 1;
+        }
+    };
+
+    struct Var;
+    struct Timescale;
+    class ChunkRecorder;
+
     class VcdParser {
+        enum ParserStates {
+            InDefinitionCmds,
+            InSimulationCmds,
+
+            InComment,
+            InDate,
+            InEndDefinitions,
+            InScope,
+            InTimescale,
+            InUpscope,
+            InVar,
+            InVersion,
+
+            InDumpall,
+            InDumpoff,
+            InDumpon,
+            InDumpvars,
+
+            InVectorValueChange,
+        };
+
         Tokenizer tokenizer;
-        VcdFormat::VcdFile vcdFile;
+        // whole input, unless it is fed in chunks
+        const char *input = nullptr;
+        size_t inputSize = 0;
+        VcdFileBuilder builder;
+        VcdHandler *handler = nullptr; // builder unless set
+        VcdFormat::Header header;
+
+        // consumed input is handed back to the source in steps of this size
+        static const size_t ReleaseInterval = 16 * 1024 * 1024;
+        InputSource *source = nullptr;
+        size_t nextReleaseOffset = ReleaseInterval;
+
+        // state of the parse() state machine, kept between feed() calls
+        ParserStates state = InDefinitionCmds;
+        ParserStates savedState = InDefinitionCmds;
+        std::unique_ptr<Var> var;
+        std::unique_ptr<Timescale> timescale;
+        // vectorValueChangeType --binary/real
+        TokenView vectorValueChangeValue;
+        size_t vectorValueOffset = 0;
+        // real_number rather than binary_number
+        bool vectorValueReal = false;
+        // when streaming, the value is copied to vectorValueBuffer
+        bool vectorValueBuffered = false;
+        std::string vectorValueBuffer;
+        std::string extendedValue;
 
         uint64_t currentTime = 0;
-        std::map<std::string, VcdFormat::Variable *> varIdentifierMap;
+        // id of identifiers that are defined but not selected
+        static const uint32_t SkippedId = IdentifierIndex::NotFound - 1;
+        IdentifierIndex identifierIndex;
+        std::vector<uint32_t> varSizes;
+        std::vector<VcdFormat::VarType> varTypes;
+
+        // definitions section, variables are handed to the handler at $enddefinitions
+        std::vector<ScopeDefinition> scopes;
+        // scope ids by parent id and name, to find scopes that are entered again
+        std::unordered_map<std::string, uint32_t> scopeIds;
+        std::vector<uint32_t> scopeStack;
+        ScopeDefinition scope;
+        int scopeTokens = 0;
+        std::vector<VarDefinition> definitions;
+        std::vector<bool> definitionSelected;
+        std::vector<std::string> namePatterns;
+        std::vector<std::string> selectedIdentifiers;
+
+        // report offsets of changes to the builder instead of their values, see StorageMode::Indexed
+        bool indexOnly = false;
+
+        unsigned int threadCount = 1;
+        // see setTimeWindow(), parseTokens() stops at the first # record after timeLimit
+        bool windowed = false;
+        uint64_t windowBegin = 0;
+        uint64_t timeLimit = UINT64_MAX;
+        // makes parseTokens() return once the definitions section has been parsed
+        bool stopAtSimulation = false;
+        bool definitionsDone = false;
+
+        ParseStats stats;
+        // start of the current parse(), feed() or finish() call, or of the simulation section
+        std::chrono::steady_clock::time_point statsClock;
+
+        /**
+         * Creates a parser for a part of the simulation section that shares the definitions of parent.
+         */
+        VcdParser(const VcdParser &parent, VcdHandler &handler);
     public:
+        /**
+         * Creates a parser that receives its input incrementally via feed() and finish().
+         */
+        VcdParser();
+
         VcdParser(const char *data, size_t len);
 
         explicit VcdParser(const std::string &buffer)
                 : VcdParser(buffer.data(), buffer.size()) {
         }
 
+        /**
+         * Parses the contents of source, releasing consumed input as the parser goes.
+         * The source is borrowed and must outlive the parser.
+         */
+        explicit VcdParser(InputSource &source);
+
+        VcdParser(VcdParser &&) noexcept;
+
+        VcdParser &operator=(VcdParser &&) noexcept;
+
+        ~VcdParser();
+
         void parse();
 
+        /**
+         * Parses the next chunk of input. Tokens may be split across chunks; the chunk
+         * isn't referenced after the call returns.
+         */
+        void feed(const char *data, size_t len);
+
+        /**
+         * Parses whatever is left after the last feed() and completes the result.
+         */
+        void finish();
+
+        /**
+         * Parses all blocks of source with feed() and then calls finish(). Reading the
+         * next block overlaps with parsing if the source produces blocks on another thread.
+         */
+        void parseStream(StreamSource &source);
+
+        /**
+         * Sends the parsed contents to handler instead of building a VcdFile. The handler
+         * is borrowed and must be set before parsing starts.
+         */
+        void setHandler(VcdHandler &handler) {
+            this->handler = &handler;
+        }
+
+        void setStorageMode(VcdFormat::StorageMode mode) {
+            builder.setStorageMode(mode);
+        }
+
+        /**
+         * Keeps only the selected variables; changes of the others are skipped without being
+         * validated or stored. Without any selection all variables are kept. Selections must be
+         * made before parsing starts.
+         *
+         * @param pattern full hierarchical name, i.e. the scopes and the reference joined by '.'
+         * ("top.cpu.alu.a"), in which '*' and '?' are wildcards
+         */
+        void selectByName(const std::string &pattern);
+
+        void selectByIdentifier(const std::string &identifierCode);
+
+        /**
+         * Parses the simulation section with count threads when the whole input is available,
+         * i.e. not with feed(). Each thread parses blocks of # records into a buffer, and the
+         * buffers are handed to the handler in file order. 0 uses one thread per core.
+         */
+        void setThreadCount(unsigned int count);
+
+        /**
+         * Only parses the changes from begin to end (both inclusive) when the whole input is
+         * available, i.e. not with feed(). The first # record at or after begin is found by
+         * bisecting over the lines starting with '#', and the values at begin are rebuilt from
+         * the closest $dumpall or $dumpvars section before it. The handler first gets a
+         * time of begin and a $dumpall section holding those values, then the changes of the
+         * window; parsing stops at the first # record after end. With StorageMode::Indexed
+         * the window is stored as with StorageMode::Packed.
+         * @throw std::invalid_argument if begin > end
+         */
+        void setTimeWindow(uint64_t begin, uint64_t end);
+
+        /**
+         * The parsed file, unless another handler has been set.
+         */
         VcdFormat::VcdFile &getResult() {
-            return vcdFile;
+            return builder.getResult();
         };
 
+        /**
+         * Statistics of the input parsed so far, if the library was built with
+         * VCDPARSER_ENABLE_STATS (see ParseStats::Enabled). The memory figures are
+         * filled in once the parse is complete.
+         */
+        const ParseStats &getStats() const {
+            return stats;
+        }
+
     private:
-        void parseScalarValueChange(const std::string &definition);
+        // not a member pointer to builder, so that the parser stays movable
+        VcdHandler *getHandler() {
+            return handler != nullptr ? handler : &builder;
+        }
+
+        void parseTokens();
+
+        // parse of one chunk by parseParallel()
+        struct ChunkResult;
+
+        void parseParallel();
+
+        void parseChunk(const char *chunk, size_t len);
+
+        void parseWindow();
+
+        static DumpSection getDumpSection(ParserStates state);
+
+        bool isSelected(const VarDefinition &var) const;
+
+        void enterScope();
+
+        void defineVariables();
+
+        void parseScalarValueChange(const TokenView &definition);
+
+        void parseVectorValueChange(const TokenView &identifier,
+                                    const TokenView &value);
+
+        void parseRealValueChange(const TokenView &identifier,
+                                  const TokenView &value);
+
+        void releaseInput(const TokenView &token);
+
+        void startStatsClock();
+
+        // adds the time since startStatsClock() to the current section
+        void stopStatsClock();
 
-        void parseVectorValueChange(const std::string &identifier,
-                                    const std::string &value);
+        void collectMemoryStats();
 
         void throwException(const char *fmt, ...);
 
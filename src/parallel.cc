@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: MIT
+
+#include "libvcdparser.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace VcdParser {
+    /**
+     * Records the events of a part of the simulation section, to be replayed to the real handler.
+     */
+    class ChunkRecorder : public VcdHandler {
+        enum EventType : uint8_t {
+            Time,
+            ScalarChange,
+            VectorChange, // value in the input buffer
+            PooledVectorChange, // value in pool
+            RealChange, // value in payload
+            DumpSectionBegin,
+            DumpSectionEnd
+        };
+
+        struct Event {
+            EventType type;
+            char value; // scalar value or dump section
+            uint32_t id;
+            uint32_t length;
+            uint64_t payload; // time, real value, or offset of the value in the input buffer or pool
+        };
+
+        const char *input;
+        size_t inputSize;
+        std::vector<Event> events;
+        std::string pool;
+
+    public:
+        ChunkRecorder(const char *input, size_t inputSize)
+                : input(input), inputSize(inputSize) {
+        }
+
+        void onTime(uint64_t time) override {
+            events.push_back({Time, 0, 0, 0, time});
+        }
+
+        void onDumpSection(DumpSection section) override {
+            events.push_back({DumpSectionBegin, static_cast<char>(section), 0, 0, 0});
+        }
+
+        void onDumpSectionEnd(DumpSection section) override {
+            events.push_back({DumpSectionEnd, static_cast<char>(section), 0, 0, 0});
+        }
+
+        void onScalarChange(uint32_t id, char value) override {
+            events.push_back({ScalarChange, value, id, 0, 0});
+        }
+
+        void onVectorChange(uint32_t id, const TokenView &value) override {
+            auto length = static_cast<uint32_t>(value.size);
+            if (value.data >= input && value.data + value.size <= input + inputSize) {
+                events.push_back({VectorChange, 0, id, length, static_cast<uint64_t>(value.data - input)});
+            } else { // left-extended value
+                events.push_back({PooledVectorChange, 0, id, length, pool.size()});
+                pool.append(value.data, value.size);
+            }
+        }
+
+        void onRealChange(uint32_t id, double value) override {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            events.push_back({RealChange, 0, id, 0, bits});
+        }
+
+        void replay(VcdHandler &handler) const {
+            for (const Event &it : events) {
+                switch (it.type) {
+                    case Time:
+                        handler.onTime(it.payload);
+                        break;
+                    case ScalarChange:
+                        handler.onScalarChange(it.id, it.value);
+                        break;
+                    case VectorChange:
+                        handler.onVectorChange(it.id, TokenView(input + it.payload, it.length));
+                        break;
+                    case PooledVectorChange:
+                        handler.onVectorChange(it.id, TokenView(pool.data() + it.payload, it.length));
+                        break;
+                    case RealChange: {
+                        double value;
+                        std::memcpy(&value, &it.payload, sizeof(value));
+                        handler.onRealChange(it.id, value);
+                        break;
+                    }
+                    case DumpSectionBegin:
+                        handler.onDumpSection(static_cast<DumpSection>(it.value));
+                        break;
+                    case DumpSectionEnd:
+                        handler.onDumpSectionEnd(static_cast<DumpSection>(it.value));
+                        break;
+                }
+            }
+        }
+
+        void clear() {
+            events.clear();
+            pool.clear();
+        }
+
+        void swap(ChunkRecorder &other) {
+            events.swap(other.events);
+            pool.swap(other.pool);
+        }
+    };
+
+    struct VcdParser::ChunkResult {
+        bool ready = false;
+        ChunkRecorder recorder;
+        // state at the end of the chunk, assuming it started in InSimulationCmds
+        ParserStates endState = InSimulationCmds;
+        ParserStates endSavedState = InSimulationCmds;
+        bool failed = false;
+        std::string errorMessage;
+        size_t errorOffset = 0;
+        std::exception_ptr exception;
+        ParseStats stats;
+
+        ChunkResult(const char *input, size_t inputSize)
+                : recorder(input, inputSize) {
+        }
+    };
+}
+
+void VcdParser::VcdParser::setThreadCount(unsigned int count) {
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = count;
+}
+
+void VcdParser::VcdParser::parseChunk(const char *chunk, size_t len) {
+    tokenizer = Tokenizer(chunk, len);
+    parseTokens();
+}
+
+void VcdParser::VcdParser::parseParallel() {
+    const size_t MinChunkSize = 1024 * 1024;
+    const size_t MaxChunkSize = 16 * 1024 * 1024;
+    const size_t bodyOffset = tokenizer.getOffset();
+    const char *body = input + bodyOffset;
+    const char *end = input + inputSize;
+
+    // split the simulation section at lines starting with '#'
+    size_t chunkSize = (end - body) / (threadCount * 8);
+    chunkSize = std::min(std::max(chunkSize, MinChunkSize), MaxChunkSize);
+    std::vector<const char *> chunkStarts;
+    for (const char *it = body; it < end;) {
+        chunkStarts.push_back(it);
+        it = end - it > static_cast<ptrdiff_t>(chunkSize) ? Utils::findTimeLine(input, it + chunkSize, end) : end;
+    }
+    chunkStarts.push_back(end);
+    size_t chunkCount = chunkStarts.size() - 1;
+    if (chunkCount < 2) {
+        parseTokens();
+        return;
+    }
+
+    // chunks being parsed or waiting to be replayed, to bound memory
+    const size_t window = threadCount * 2;
+    std::vector<std::unique_ptr<ChunkResult>> results(chunkCount);
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t nextChunk = 0;
+    size_t replayedChunks = 0;
+    bool cancelled = false;
+
+    auto work = [&]() {
+        ChunkRecorder recorder(input, inputSize);
+        VcdParser worker(*this, recorder);
+        while (true) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]() {
+                    return cancelled || nextChunk >= chunkCount || nextChunk < replayedChunks + window;
+                });
+                if (cancelled || nextChunk >= chunkCount) {
+                    return;
+                }
+                index = nextChunk++;
+            }
+            std::unique_ptr<ChunkResult> result(new ChunkResult(input, inputSize));
+            try {
+                worker.state = InSimulationCmds;
+                worker.savedState = InSimulationCmds;
+                VCDPARSER_STAT(worker.stats.variableChanges.resize(varSizes.size()));
+                worker.parseChunk(chunkStarts[index], chunkStarts[index + 1] - chunkStarts[index]);
+                result->endState = worker.state;
+                result->endSavedState = worker.savedState;
+            } catch (const VcdException &exception) {
+                result->failed = true;
+                result->errorMessage = exception.msg;
+                result->errorOffset = (chunkStarts[index] - input) + worker.tokenizer.getLastOffset();
+            } catch (...) {
+                result->exception = std::current_exception();
+            }
+            result->recorder.swap(recorder);
+            recorder.clear();
+            VCDPARSER_STAT(result->stats = std::move(worker.stats); worker.stats = ParseStats());
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                result->ready = true;
+                results[index] = std::move(result);
+            }
+            condition.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    auto stopThreads = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = true;
+        }
+        condition.notify_all();
+        for (auto &it : threads) {
+            it.join();
+        }
+        threads.clear();
+    };
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads.emplace_back(work);
+    }
+
+    try {
+        for (size_t i = 0; i < chunkCount; i++) {
+            std::unique_ptr<ChunkResult> result;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]() {
+                    return results[i] && results[i]->ready;
+                });
+                result = std::move(results[i]);
+            }
+            if (state != InSimulationCmds || savedState != InSimulationCmds
+                || result->endState == InVectorValueChange) {
+                // a comment or dump section crosses the chunk's start, so the worker got it wrong,
+                // or the chunk ends in the middle of a value change whose value the worker keeps;
+                // whatever the worker's attempt failed with doesn't apply
+                result->failed = false;
+                result->errorMessage.clear();
+                result->errorOffset = 0;
+                result->exception = nullptr;
+                try {
+                    parseChunk(chunkStarts[i], chunkStarts[i + 1] - chunkStarts[i]);
+                } catch (const VcdException &exception) {
+                    result->failed = true;
+                    result->errorMessage = exception.msg;
+                    result->errorOffset = (chunkStarts[i] - input) + tokenizer.getLastOffset();
+                }
+            } else {
+                result->recorder.replay(*getHandler());
+                VCDPARSER_STAT(stats.merge(result->stats));
+                state = result->endState;
+                savedState = result->endSavedState;
+            }
+            if (result->exception) {
+                std::rethrow_exception(result->exception);
+            }
+            if (result->failed) {
+                size_t line, column;
+                Utils::locateOffset(input, result->errorOffset, line, column);
+                throw VcdException(result->errorMessage, line, column);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                replayedChunks = i + 1;
+            }
+            condition.notify_all();
+            if (source != nullptr) {
+                source->release(chunkStarts[i + 1] - input);
+            }
+        }
+    } catch (...) {
+        stopThreads();
+        throw;
+    }
+    stopThreads();
+    tokenizer = Tokenizer(end, 0);
+}
@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: MIT
+
+#include "pyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace VcdFormat {
+    namespace {
+        const double NoValue = std::numeric_limits<double>::quiet_NaN();
+
+        // like std::min/max, but NaN only if both are
+        double lower(double a, double b) {
+            return std::isnan(a) || b < a ? b : a;
+        }
+
+        double higher(double a, double b) {
+            return std::isnan(a) || b > a ? b : a;
+        }
+    }
+
+    DetailPyramid::DetailPyramid(const VcdFile &file, const Variable &alias)
+            : file(file),
+              variable(alias.getCanonical()),
+              real(variable.isReal()) {
+        const std::vector<uint64_t> &timestamps = file.timestamps;
+        uint64_t changeCount = getChangeCount();
+        // the finest level with at most one bucket per change
+        while ((timestamps.size() >> baseLevel) > std::max<uint64_t>(changeCount, 1)) {
+            baseLevel++;
+        }
+        size_t bucketCount = timestamps.empty() ? 0 : ((timestamps.size() - 1) >> baseLevel) + 1;
+        std::vector<Bucket> base(bucketCount, Bucket{0, 0});
+        std::vector<double> baseMinima;
+        std::vector<double> baseMaxima;
+        if (real) {
+            baseMinima.assign(bucketCount, NoValue);
+            baseMaxima.assign(bucketCount, NoValue);
+            for (const RealValueChange &change : variable.realChanges) {
+                uint64_t timeIndex = std::lower_bound(timestamps.begin(), timestamps.end(), change.time)
+                                     - timestamps.begin();
+                size_t bucket = std::min<size_t>(timeIndex >> baseLevel, bucketCount - 1);
+                base[bucket].transitions++;
+                baseMinima[bucket] = lower(baseMinima[bucket], change.value);
+                baseMaxima[bucket] = higher(baseMaxima[bucket], change.value);
+            }
+        } else {
+            resumePoints.resize(bucketCount);
+            const VectorChanges &changes = variable.changes;
+            for (ChangeIterator it(changes, timestamps.data(), 0); it.index() < changes.count; ++it) {
+                size_t bucket = it.timeIndex() >> baseLevel;
+                if (base[bucket].transitions++ == 0) {
+                    resumePoints[bucket] = {it.timeIndex(), it.deltaOffset};
+                }
+            }
+        }
+        uint64_t changesBefore = 0;
+        for (Bucket &bucket : base) {
+            bucket.changesBefore = changesBefore;
+            changesBefore += bucket.transitions;
+        }
+        levels.push_back(std::move(base));
+        minima.push_back(std::move(baseMinima));
+        maxima.push_back(std::move(baseMaxima));
+
+        // every level halves the one below, up to a single bucket
+        while (levels.back().size() > 1) {
+            const std::vector<Bucket> &below = levels.back();
+            std::vector<Bucket> level((below.size() + 1) / 2);
+            for (size_t i = 0; i < level.size(); i++) {
+                level[i] = below[i * 2];
+                if (i * 2 + 1 < below.size()) {
+                    level[i].transitions += below[i * 2 + 1].transitions;
+                }
+            }
+            if (real) {
+                const std::vector<double> &minimaBelow = minima.back();
+                const std::vector<double> &maximaBelow = maxima.back();
+                std::vector<double> levelMinima(level.size());
+                std::vector<double> levelMaxima(level.size());
+                for (size_t i = 0; i < level.size(); i++) {
+                    levelMinima[i] = minimaBelow[i * 2];
+                    levelMaxima[i] = maximaBelow[i * 2];
+                    if (i * 2 + 1 < below.size()) {
+                        levelMinima[i] = lower(levelMinima[i], minimaBelow[i * 2 + 1]);
+                        levelMaxima[i] = higher(levelMaxima[i], maximaBelow[i * 2 + 1]);
+                    }
+                }
+                minima.push_back(std::move(levelMinima));
+                maxima.push_back(std::move(levelMaxima));
+            }
+            levels.push_back(std::move(level));
+        }
+    }
+
+    uint64_t DetailPyramid::getChangeCount() const {
+        return real ? variable.realChanges.size() : variable.changes.count;
+    }
+
+    void DetailPyramid::addPartial(uint64_t begin, uint64_t end, Span &span) const {
+        const std::vector<uint64_t> &timestamps = file.timestamps;
+        size_t bucket = begin >> baseLevel;
+        if (begin >= end || levels[0][bucket].transitions == 0) {
+            return;
+        }
+        if (real) {
+            // real changes are stored by time rather than by time index
+            const RealValueChange *first = variable.realChanges.begin();
+            const RealValueChange *last = variable.realChanges.end();
+            auto byTime = [](const RealValueChange &change, uint64_t time) {
+                return change.time < time;
+            };
+            const RealValueChange *it = std::lower_bound(first, last, timestamps[begin], byTime);
+            const RealValueChange *stop = end < timestamps.size()
+                                          ? std::lower_bound(it, last, timestamps[end], byTime) : last;
+            for (; it != stop; ++it) {
+                span.transitions++;
+                span.min = lower(span.min, it->value);
+                span.max = higher(span.max, it->value);
+            }
+            return;
+        }
+        const Bucket &base = levels[0][bucket];
+        const ResumePoint &resume = resumePoints[bucket];
+        ChangeIterator it(variable.changes, timestamps.data(), base.changesBefore, resume.timeIndex,
+                          resume.nextDeltaOffset);
+        for (uint64_t i = 0; i < base.transitions && it.timeIndex() < end; i++, ++it) {
+            if (it.timeIndex() >= begin) {
+                span.transitions++;
+            }
+        }
+    }
+
+    void DetailPyramid::addBucket(size_t level, size_t bucket, Span &span) const {
+        span.transitions += levels[level][bucket].transitions;
+        if (real) {
+            span.min = lower(span.min, minima[level][bucket]);
+            span.max = higher(span.max, maxima[level][bucket]);
+        }
+    }
+
+    void DetailPyramid::addRange(uint64_t begin, uint64_t end, Span &span) const {
+        const uint64_t bucketSize = uint64_t(1) << baseLevel;
+        // the parts at both ends that don't fill a bucket of levels[0]
+        uint64_t alignedBegin = std::min(end, (begin + bucketSize - 1) & ~(bucketSize - 1));
+        addPartial(begin, alignedBegin, span);
+        uint64_t alignedEnd = std::max(alignedBegin, end & ~(bucketSize - 1));
+        addPartial(alignedEnd, end, span);
+        // the rest is covered by at most two buckets per level
+        size_t first = alignedBegin >> baseLevel;
+        size_t last = alignedEnd >> baseLevel;
+        for (size_t level = 0; first < last; level++, first >>= 1, last >>= 1) {
+            if (first & 1) {
+                addBucket(level, first++, span);
+            }
+            if (last & 1) {
+                addBucket(level, --last, span);
+            }
+        }
+    }
+
+    uint64_t DetailPyramid::countBefore(uint64_t timeIndex) const {
+        size_t bucket = timeIndex >> baseLevel;
+        if (bucket >= levels[0].size()) {
+            return getChangeCount();
+        }
+        Span span;
+        addPartial(bucket << baseLevel, timeIndex, span);
+        return levels[0][bucket].changesBefore + span.transitions;
+    }
+
+    DetailPyramid::Span DetailPyramid::summarize(uint64_t begin, uint64_t end) const {
+        const std::vector<uint64_t> &timestamps = file.timestamps;
+        uint64_t first = std::lower_bound(timestamps.begin(), timestamps.end(), begin) - timestamps.begin();
+        uint64_t last = std::lower_bound(timestamps.begin() + first, timestamps.end(), end) - timestamps.begin();
+        Span span;
+        uint64_t changesBefore = countBefore(first);
+        if (real && changesBefore != 0) {
+            // the value the span starts with
+            span.min = span.max = variable.realChanges[changesBefore - 1].value;
+        }
+        if (first < last) {
+            addRange(first, last, span);
+        }
+        span.changes = changesBefore + span.transitions;
+        return span;
+    }
+
+    std::vector<DetailPyramid::Span> DetailPyramid::render(uint64_t begin, uint64_t end, size_t pixels) const {
+        std::vector<Span> spans;
+        spans.reserve(pixels);
+        // end is inclusive, the length may not fit into 64 bits
+        long double length = static_cast<long double>(end) - begin + 1;
+        uint64_t spanBegin = begin;
+        for (size_t i = 0; i < pixels; i++) {
+            uint64_t spanEnd = i + 1 == pixels
+                               ? end + 1 : begin + static_cast<uint64_t>(length * (i + 1) / pixels);
+            spans.push_back(summarize(spanBegin, spanEnd == 0 && end != 0 ? UINT64_MAX : spanEnd));
+            spanBegin = spanEnd;
+        }
+        return spans;
+    }
+
+    size_t DetailPyramid::getMemoryUsage() const {
+        size_t bytes = resumePoints.capacity() * sizeof(ResumePoint);
+        for (size_t i = 0; i < levels.size(); i++) {
+            bytes += levels[i].capacity() * sizeof(Bucket);
+        }
+        for (size_t i = 0; i < minima.size(); i++) {
+            bytes += (minima[i].capacity() + maxima[i].capacity()) * sizeof(double);
+        }
+        return bytes;
+    }
+}
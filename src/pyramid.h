@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "libvcdparser.h"
+
+namespace VcdFormat {
+    /**
+     * Level-of-detail summary of the changes of one variable, for drawing it zoomed out.
+     *
+     * Time is divided into buckets of 2^k timestamps (indices into VcdFile::timestamps) for
+     * every level k. A bucket holds the number of changes in it, which is 0 if the value was
+     * stable, the number of changes before it, which locates its value, and for real
+     * variables the smallest and largest value. Levels finer than the average distance
+     * between changes aren't stored; ranges inside one bucket of the finest stored level
+     * are decoded from the changes instead.
+     *
+     * Built after parsing, for packed (StorageMode::Packed, or loaded Indexed) and real
+     * variables. The file must outlive the pyramid and must not be modified while it's in use.
+     */
+    class DetailPyramid {
+    public:
+        /**
+         * Summary of the changes during a span of time.
+         */
+        struct Span {
+            // changes during the span, 0 if the value was stable
+            uint64_t transitions = 0;
+            // changes before the end of the span; the value at its end is change changes - 1,
+            // and the one at its start change changes - transitions - 1 (none if negative)
+            uint64_t changes = 0;
+            // real variables: the smallest and largest value during the span, NaN without any
+            double min = std::numeric_limits<double>::quiet_NaN();
+            double max = std::numeric_limits<double>::quiet_NaN();
+
+            bool isStable() const {
+                return transitions == 0;
+            }
+        };
+
+        DetailPyramid(const VcdFile &file, const Variable &variable);
+
+        /**
+         * Summaries of pixels spans of equal length that together cover begin <= time <= end.
+         * Each span takes O(log T) for T timestamps.
+         */
+        std::vector<Span> render(uint64_t begin, uint64_t end, size_t pixels) const;
+
+        /**
+         * Summary of the changes with begin <= time < end.
+         */
+        Span summarize(uint64_t begin, uint64_t end) const;
+
+        size_t getMemoryUsage() const;
+
+    private:
+        struct Bucket {
+            uint64_t transitions;
+            uint64_t changesBefore;
+        };
+
+        // a change whose time has been decoded, to decode the rest of a bucket from
+        struct ResumePoint {
+            uint64_t timeIndex;
+            size_t nextDeltaOffset;
+        };
+
+        const VcdFile &file;
+        const Variable &variable;
+        bool real;
+        // log2 of the number of timestamps in a bucket of levels[0]
+        unsigned int baseLevel = 0;
+        std::vector<std::vector<Bucket>> levels;
+        // by level like levels, only for real variables
+        std::vector<std::vector<double>> minima;
+        std::vector<std::vector<double>> maxima;
+        // first change of every bucket of levels[0] that has one, packed variables only
+        std::vector<ResumePoint> resumePoints;
+
+        uint64_t getChangeCount() const;
+
+        // adds the changes with time indices in [begin, end), which lie in one bucket of levels[0]
+        void addPartial(uint64_t begin, uint64_t end, Span &span) const;
+
+        void addBucket(size_t level, size_t bucket, Span &span) const;
+
+        // adds the changes with time indices in [begin, end)
+        void addRange(uint64_t begin, uint64_t end, Span &span) const;
+
+        // number of changes with a time index below timeIndex
+        uint64_t countBefore(uint64_t timeIndex) const;
+    };
+}
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MIT
+
+#include "query.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace VcdFormat {
+    const size_t VcdQuery::CheckpointInterval;
+
+    VcdQuery::VcdQuery(const VcdFile &file)
+            : file(file) {
+        for (const Variable *variable : file.variableList) {
+            if (variable->changes.count == 0) {
+                continue;
+            }
+            std::vector<Checkpoint> &list = checkpoints[variable];
+            list.reserve(variable->changes.count / CheckpointInterval + 1);
+            for (const ChangeIterator &it : file.getChanges(*variable)) {
+                if (it.index() % CheckpointInterval == 0) {
+                    list.push_back({it.timeIndex(), it.deltaOffset});
+                }
+            }
+        }
+    }
+
+    uint64_t VcdQuery::countTimestamps(uint64_t time, bool inclusive) const {
+        const std::vector<uint64_t> &timestamps = file.timestamps;
+        auto it = inclusive ? std::upper_bound(timestamps.begin(), timestamps.end(), time)
+                            : std::lower_bound(timestamps.begin(), timestamps.end(), time);
+        return it - timestamps.begin();
+    }
+
+    size_t VcdQuery::countChanges(const Variable &variable, uint64_t timeIndex) const {
+        auto found = checkpoints.find(&variable);
+        if (found == checkpoints.end()) {
+            return 0;
+        }
+        const std::vector<Checkpoint> &list = found->second;
+        auto next = std::lower_bound(list.begin(), list.end(), timeIndex,
+                                     [](const Checkpoint &checkpoint, uint64_t timeIndex) {
+                                         return checkpoint.timeIndex < timeIndex;
+                                     });
+        if (next == list.begin()) {
+            return 0;
+        }
+        // the changes before the next checkpoint are decoded from the previous one
+        size_t change = (next - list.begin() - 1) * CheckpointInterval;
+        const VectorChanges &changes = variable.changes;
+        ChangeIterator it(changes, file.timestamps.data(), change, next[-1].timeIndex, next[-1].nextDeltaOffset);
+        size_t count = change + 1;
+        for (++it; it.index() < changes.count && it.timeIndex() < timeIndex; ++it) {
+            count++;
+        }
+        return count;
+    }
+
+    ChangeIterator VcdQuery::iteratorAt(const Variable &variable, size_t change) const {
+        const VectorChanges &changes = variable.changes;
+        if (change >= changes.count) {
+            return ChangeIterator(changes, file.timestamps.data(), changes.count);
+        }
+        const Checkpoint &checkpoint = checkpoints.at(&variable)[change / CheckpointInterval];
+        ChangeIterator it(changes, file.timestamps.data(), change - change % CheckpointInterval,
+                          checkpoint.timeIndex, checkpoint.nextDeltaOffset);
+        for (size_t i = 0; i < change % CheckpointInterval; i++) {
+            ++it;
+        }
+        return it;
+    }
+
+    std::string VcdQuery::valueBefore(const Variable &variable, uint64_t timeIndex, uint64_t time) const {
+        if (variable.isReal()) {
+            const RealValueChange *it = std::upper_bound(variable.realChanges.begin(), variable.realChanges.end(), time,
+                                                         [](uint64_t time, const RealValueChange &change) {
+                                                             return time < change.time;
+                                                         });
+            if (it == variable.realChanges.begin()) {
+                return "x";
+            }
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.17g", it[-1].value);
+            return buffer;
+        }
+        if (variable.signalLists.empty()) {
+            size_t count = countChanges(variable, timeIndex);
+            return count == 0 ? std::string(variable.width, 'x') : variable.changes.getValue(count - 1);
+        }
+        std::string value(variable.signalLists.size(), 'x');
+        for (size_t i = 0; i < value.size(); i++) {
+            const std::vector<ValueChange> &values = variable.signalLists[i].values;
+            auto it = std::upper_bound(values.begin(), values.end(), time,
+                                       [](uint64_t time, const ValueChange &change) {
+                                           return time < change.time;
+                                       });
+            if (it != values.begin()) {
+                value[i] = it[-1].data;
+            }
+        }
+        return value;
+    }
+
+    std::string VcdQuery::valueAt(const Variable &variable, uint64_t time) const {
+        return valueBefore(variable.getCanonical(), countTimestamps(time, true), time);
+    }
+
+    ChangeIterator VcdQuery::changeAt(const Variable &alias, uint64_t time) const {
+        const Variable &variable = alias.getCanonical();
+        size_t count = countChanges(variable, countTimestamps(time, true));
+        return iteratorAt(variable, count == 0 ? variable.changes.count : count - 1);
+    }
+
+    ChangeRange VcdQuery::changesBetween(const Variable &alias, uint64_t begin, uint64_t end) const {
+        const Variable &variable = alias.getCanonical();
+        size_t first = countChanges(variable, countTimestamps(begin, false));
+        size_t last = std::max(first, countChanges(variable, countTimestamps(end, true)));
+        return {iteratorAt(variable, first), iteratorAt(variable, last)};
+    }
+
+    BitChangeRange VcdQuery::bitChangesBetween(const Variable &variable, unsigned int index,
+                                               uint64_t begin, uint64_t end) const {
+        const std::vector<ValueChange> &values = variable.getCanonical().signalLists[index].values;
+        auto first = std::lower_bound(values.begin(), values.end(), begin,
+                                      [](const ValueChange &change, uint64_t time) {
+                                          return change.time < time;
+                                      });
+        auto last = std::upper_bound(first, values.end(), end,
+                                     [](uint64_t time, const ValueChange &change) {
+                                         return time < change.time;
+                                     });
+        BitChangeRange range;
+        range.first = values.data() + (first - values.begin());
+        range.last = values.data() + (last - values.begin());
+        return range;
+    }
+
+    std::vector<std::string> VcdQuery::snapshotAt(uint64_t time) const {
+        return snapshotAt(time, std::vector<const Variable *>(file.variableList.begin(), file.variableList.end()));
+    }
+
+    std::vector<std::string> VcdQuery::snapshotAt(uint64_t time, const std::vector<const Variable *> &variables) const {
+        uint64_t timeIndex = countTimestamps(time, true);
+        std::vector<std::string> values;
+        values.reserve(variables.size());
+        for (const Variable *variable : variables) {
+            values.push_back(valueBefore(variable->getCanonical(), timeIndex, time));
+        }
+        return values;
+    }
+}
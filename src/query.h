@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "libvcdparser.h"
+
+namespace VcdFormat {
+    /**
+     * Changes of one bit stored with StorageMode::PerBit.
+     */
+    struct BitChangeRange {
+        const ValueChange *first = nullptr;
+        const ValueChange *last = nullptr;
+
+        const ValueChange *begin() const {
+            return first;
+        }
+
+        const ValueChange *end() const {
+            return last;
+        }
+
+        size_t size() const {
+            return last - first;
+        }
+    };
+
+    /**
+     * Looks up values of a parsed VcdFile by time, in either storage mode.
+     *
+     * Packed changes can only be decoded front to back, so every CheckpointInterval-th
+     * change of a variable is remembered with its time; a lookup binary searches the
+     * checkpoints and decodes at most CheckpointInterval changes from there.
+     * Times of the file are assumed not to decrease.
+     *
+     * The file must outlive the query and must not be modified while it's in use.
+     */
+    class VcdQuery {
+    public:
+        static const size_t CheckpointInterval = 64;
+
+        explicit VcdQuery(const VcdFile &file);
+
+        /**
+         * Value of a variable at time, i.e. after all changes up to and including time,
+         * most significant bit first. Bits without a change yet are 'x'. The value of a real
+         * variable is its number printed with %.17g, which reads back exactly, or "x" before
+         * its first change.
+         */
+        std::string valueAt(const Variable &variable, uint64_t time) const;
+
+        /**
+         * Last change of a packed variable at or before time, or the end of its changes if there is none.
+         */
+        ChangeIterator changeAt(const Variable &variable, uint64_t time) const;
+
+        /**
+         * Changes of a packed variable with begin <= time <= end.
+         */
+        ChangeRange changesBetween(const Variable &variable, uint64_t begin, uint64_t end) const;
+
+        /**
+         * Changes of one bit of a per-bit variable with begin <= time <= end.
+         * @param index index of the bit as in signalLists, 0 is the most significant bit
+         */
+        BitChangeRange bitChangesBetween(const Variable &variable, unsigned int index,
+                                         uint64_t begin, uint64_t end) const;
+
+        /**
+         * Values of all variables at time as in valueAt(), in the order of VcdFile::variableList.
+         */
+        std::vector<std::string> snapshotAt(uint64_t time) const;
+
+        std::vector<std::string> snapshotAt(uint64_t time, const std::vector<const Variable *> &variables) const;
+
+    private:
+        struct Checkpoint {
+            uint64_t timeIndex;
+            size_t nextDeltaOffset; // offset of the time delta of the following change
+        };
+
+        const VcdFile &file;
+        std::unordered_map<const Variable *, std::vector<Checkpoint>> checkpoints;
+
+        // number of timestamps < time, or <= time if inclusive
+        uint64_t countTimestamps(uint64_t time, bool inclusive) const;
+
+        // number of changes with a time index below timeIndex
+        size_t countChanges(const Variable &variable, uint64_t timeIndex) const;
+
+        ChangeIterator iteratorAt(const Variable &variable, size_t change) const;
+
+        std::string valueBefore(const Variable &variable, uint64_t timeIndex, uint64_t time) const;
+    };
+}
@@ -0,0 +1,411 @@
+// SPDX-License-Identifier: MIT
+
+#include "simd.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VCDPARSER_HAVE_SSE2 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(VCDPARSER_HAVE_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#define VCDPARSER_HAVE_AVX2 1
+#endif
+
+#if defined(__GNUC__)
+#define VCDPARSER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define VCDPARSER_TARGET_AVX2
+#endif
+
+namespace VcdParser {
+    namespace Simd {
+        static inline unsigned int countTrailingZeros(unsigned int mask) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+
+        static inline unsigned int reverse16(unsigned int x) {
+            x = ((x >> 1) & 0x5555) | ((x & 0x5555) << 1);
+            x = ((x >> 2) & 0x3333) | ((x & 0x3333) << 2);
+            x = ((x >> 4) & 0x0F0F) | ((x & 0x0F0F) << 4);
+            return ((x >> 8) & 0x00FF) | ((x & 0x00FF) << 8);
+        }
+
+        static inline uint32_t reverse32(uint32_t x) {
+            return (reverse16(x & 0xFFFF) << 16) | reverse16(x >> 16);
+        }
+
+        // moves bit i of x to bit 2 * i
+        static inline uint32_t spread16(uint32_t x) {
+            x = (x | (x << 8)) & 0x00FF00FF;
+            x = (x | (x << 4)) & 0x0F0F0F0F;
+            x = (x | (x << 2)) & 0x33333333;
+            return (x | (x << 1)) & 0x55555555;
+        }
+
+        static inline uint64_t spread32(uint64_t x) {
+            x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+            x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+            x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+            x = (x | (x << 2)) & 0x3333333333333333ull;
+            return (x | (x << 1)) & 0x5555555555555555ull;
+        }
+
+        static Level detectLevel() {
+#if defined(VCDPARSER_HAVE_AVX2) && defined(__GNUC__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return Level::AVX2;
+            }
+#elif defined(VCDPARSER_HAVE_AVX2) && defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] >= 7) {
+                __cpuid(info, 1);
+                bool osxsave = (info[2] & (1 << 27)) != 0;
+                bool avx = (info[2] & (1 << 28)) != 0;
+                __cpuidex(info, 7, 0);
+                bool avx2 = (info[1] & (1 << 5)) != 0;
+                // the OS must save the upper halves of the ymm registers
+                if (osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6) {
+                    return Level::AVX2;
+                }
+            }
+#endif
+#ifdef VCDPARSER_HAVE_SSE2
+            return Level::SSE2;
+#else
+            return Level::Scalar;
+#endif
+        }
+
+        Level getSupportedLevel() {
+            static const Level level = detectLevel();
+            return level;
+        }
+
+        Level clampLevel(Level level) {
+            Level supported = getSupportedLevel();
+            return static_cast<int>(level) > static_cast<int>(supported) ? supported : level;
+        }
+
+        static const char *findDelimiterScalar(const char *p, const char *end) {
+            while (p < end && !isDelimiter(*p)) {
+                p++;
+            }
+            return p;
+        }
+
+#ifdef VCDPARSER_HAVE_SSE2
+
+        static inline __m128i matchDelimiters(__m128i v) {
+            __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+            return _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+        }
+
+        static const char *findDelimiterSse2(const char *p, const char *end) {
+            while (end - p >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                auto mask = static_cast<unsigned int>(_mm_movemask_epi8(matchDelimiters(v)));
+                if (mask != 0) {
+                    return p + countTrailingZeros(mask);
+                }
+                p += 16;
+            }
+            return findDelimiterScalar(p, end);
+        }
+
+#endif
+
+#ifdef VCDPARSER_HAVE_AVX2
+
+        VCDPARSER_TARGET_AVX2
+        static const char *findDelimiterAvx2(const char *p, const char *end) {
+            // most tokens are short, so look at the first 16 bytes before going wide
+            if (end - p >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                auto mask = static_cast<unsigned int>(_mm_movemask_epi8(matchDelimiters(v)));
+                if (mask != 0) {
+                    return p + countTrailingZeros(mask);
+                }
+                p += 16;
+            }
+            while (end - p >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+                m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+                m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+                m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+                auto mask = static_cast<unsigned int>(_mm256_movemask_epi8(m));
+                if (mask != 0) {
+                    return p + countTrailingZeros(mask);
+                }
+                p += 32;
+            }
+            return findDelimiterSse2(p, end);
+        }
+
+#endif
+
+        FindDelimiterFunction getFindDelimiter(Level level) {
+            switch (clampLevel(level)) {
+#ifdef VCDPARSER_HAVE_AVX2
+                case Level::AVX2:
+                    return findDelimiterAvx2;
+#endif
+#ifdef VCDPARSER_HAVE_SSE2
+                case Level::SSE2:
+                    return findDelimiterSse2;
+#endif
+                default:
+                    return findDelimiterScalar;
+            }
+        }
+
+        static const uint8_t InvalidValue = 4;
+
+        /**
+         * The VcdFormat::LogicState of every value character, InvalidValue for the others;
+         * looked up without branching on the character, as values are too random to predict.
+         */
+        struct ValueStates {
+            uint8_t states[256];
+
+            ValueStates() {
+                for (int ch = 0; ch < 256; ch++) {
+                    states[ch] = isValueChar(static_cast<char>(ch))
+                                 ? static_cast<uint8_t>(VcdFormat::toLogicState(static_cast<char>(ch))) : InvalidValue;
+                }
+            }
+        };
+
+        static const uint8_t *getValueStates() {
+            static const ValueStates table;
+            return table.states;
+        }
+
+        static const char *findInvalidValueScalar(const char *p, const char *end) {
+            const uint8_t *states = getValueStates();
+            while (p < end && states[static_cast<uint8_t>(*p)] != InvalidValue) {
+                p++;
+            }
+            return p;
+        }
+
+        // packs the bits from index from on, counted from the end of value
+        static void packValueTail(uint8_t *states, const char *value, size_t length, size_t from) {
+            const uint8_t *valueStates = getValueStates();
+            for (size_t i = from; i < length; i++) {
+                states[i / 4] |= valueStates[static_cast<uint8_t>(value[length - 1 - i])] << (i % 4 * 2);
+            }
+        }
+
+        static void packValueScalar(uint8_t *states, const char *value, size_t length) {
+            packValueTail(states, value, length, 0);
+        }
+
+        static bool toBinaryTail(uint64_t *words, const char *value, size_t length, size_t from) {
+            unsigned int invalid = 0;
+            for (size_t i = from; i < length; i++) {
+                unsigned int bit = static_cast<uint8_t>(value[length - 1 - i]) - '0';
+                invalid |= bit;
+                words[i / 64] |= static_cast<uint64_t>(bit & 1) << (i % 64);
+            }
+            return invalid <= 1;
+        }
+
+        static bool toBinaryScalar(uint64_t *words, const char *value, size_t length) {
+            std::memset(words, 0, (length + 63) / 64 * sizeof(uint64_t));
+            return toBinaryTail(words, value, length, 0);
+        }
+
+#ifdef VCDPARSER_HAVE_SSE2
+
+        // only letters map to 'x', 'z' and 'u' when setting 0x20, the lower case bit
+        static inline __m128i matchValueChars(__m128i v) {
+            __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+            __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('0')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('1')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(lower, _mm_set1_epi8('x')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(lower, _mm_set1_epi8('z')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(lower, _mm_set1_epi8('u')));
+            return _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+        }
+
+        static const char *findInvalidValueSse2(const char *p, const char *end) {
+            while (end - p >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                auto mask = static_cast<unsigned int>(_mm_movemask_epi8(matchValueChars(v))) ^ 0xFFFF;
+                if (mask != 0) {
+                    return p + countTrailingZeros(mask);
+                }
+                p += 16;
+            }
+            return findInvalidValueScalar(p, end);
+        }
+
+        /*
+         * The vector kernels work on blocks of characters from the end of the value, the
+         * least significant bits. A block's movemask has the bit of its last character in the
+         * highest position, so it's reversed to get the bits in value order.
+         */
+
+        static void packValueSse2(uint8_t *states, const char *value, size_t length) {
+            size_t bit = 0;
+            for (; length - bit >= 16; bit += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(value + length - bit - 16));
+                __m128i one = _mm_cmpeq_epi8(v, _mm_set1_epi8('1'));
+                __m128i known = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('0')), one);
+                // 1 and z have the low bit set, everything but 0 and 1 the high bit
+                __m128i z = _mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('z'));
+                unsigned int low = reverse16(static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(one, z))));
+                unsigned int high = reverse16(static_cast<unsigned int>(_mm_movemask_epi8(known)) ^ 0xFFFF);
+                uint32_t packed = spread16(low) | (spread16(high) << 1);
+                uint32_t current;
+                std::memcpy(&current, states + bit / 4, sizeof(current));
+                current |= packed;
+                std::memcpy(states + bit / 4, &current, sizeof(current));
+            }
+            packValueTail(states, value, length, bit);
+        }
+
+        static bool toBinarySse2(uint64_t *words, const char *value, size_t length) {
+            std::memset(words, 0, (length + 63) / 64 * sizeof(uint64_t));
+            size_t bit = 0;
+            for (; length - bit >= 16; bit += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(value + length - bit - 16));
+                __m128i one = _mm_cmpeq_epi8(v, _mm_set1_epi8('1'));
+                __m128i binary = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('0')), one);
+                if (_mm_movemask_epi8(binary) != 0xFFFF) {
+                    return false;
+                }
+                uint64_t bits = reverse16(static_cast<unsigned int>(_mm_movemask_epi8(one)));
+                words[bit / 64] |= bits << (bit % 64);
+            }
+            return toBinaryTail(words, value, length, bit);
+        }
+
+#endif
+
+#ifdef VCDPARSER_HAVE_AVX2
+
+        VCDPARSER_TARGET_AVX2
+        static const char *findInvalidValueAvx2(const char *p, const char *end) {
+            while (end - p >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+                __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('0')),
+                                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('1')));
+                m = _mm256_or_si256(m, _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('x')));
+                m = _mm256_or_si256(m, _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('z')));
+                m = _mm256_or_si256(m, _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('u')));
+                m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+                auto mask = ~static_cast<unsigned int>(_mm256_movemask_epi8(m));
+                if (mask != 0) {
+                    return p + countTrailingZeros(mask);
+                }
+                p += 32;
+            }
+            return findInvalidValueSse2(p, end);
+        }
+
+        VCDPARSER_TARGET_AVX2
+        static void packValueAvx2(uint8_t *states, const char *value, size_t length) {
+            size_t bit = 0;
+            for (; length - bit >= 32; bit += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(value + length - bit - 32));
+                __m256i one = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('1'));
+                __m256i known = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('0')), one);
+                __m256i z = _mm256_cmpeq_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('z'));
+                uint32_t low = reverse32(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(one, z))));
+                uint32_t high = reverse32(~static_cast<uint32_t>(_mm256_movemask_epi8(known)));
+                uint64_t packed = spread32(low) | (spread32(high) << 1);
+                uint64_t current;
+                std::memcpy(&current, states + bit / 4, sizeof(current));
+                current |= packed;
+                std::memcpy(states + bit / 4, &current, sizeof(current));
+            }
+            packValueSse2(states + bit / 4, value, length - bit);
+        }
+
+        VCDPARSER_TARGET_AVX2
+        static bool toBinaryAvx2(uint64_t *words, const char *value, size_t length) {
+            std::memset(words, 0, (length + 63) / 64 * sizeof(uint64_t));
+            size_t bit = 0;
+            for (; length - bit >= 32; bit += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(value + length - bit - 32));
+                __m256i one = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('1'));
+                __m256i binary = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('0')), one);
+                if (~static_cast<uint32_t>(_mm256_movemask_epi8(binary)) != 0) {
+                    return false;
+                }
+                uint64_t bits = reverse32(static_cast<uint32_t>(_mm256_movemask_epi8(one)));
+                words[bit / 64] |= bits << (bit % 64);
+            }
+            return toBinaryTail(words, value, length, bit);
+        }
+
+#endif
+
+        FindInvalidValueFunction getFindInvalidValue(Level level) {
+            switch (clampLevel(level)) {
+#ifdef VCDPARSER_HAVE_AVX2
+                case Level::AVX2:
+                    return findInvalidValueAvx2;
+#endif
+#ifdef VCDPARSER_HAVE_SSE2
+                case Level::SSE2:
+                    return findInvalidValueSse2;
+#endif
+                default:
+                    return findInvalidValueScalar;
+            }
+        }
+
+        PackValueFunction getPackValue(Level level) {
+            switch (clampLevel(level)) {
+#ifdef VCDPARSER_HAVE_AVX2
+                case Level::AVX2:
+                    return packValueAvx2;
+#endif
+#ifdef VCDPARSER_HAVE_SSE2
+                case Level::SSE2:
+                    return packValueSse2;
+#endif
+                default:
+                    return packValueScalar;
+            }
+        }
+
+        ToBinaryFunction getToBinary(Level level) {
+            switch (clampLevel(level)) {
+#ifdef VCDPARSER_HAVE_AVX2
+                case Level::AVX2:
+                    return toBinaryAvx2;
+#endif
+#ifdef VCDPARSER_HAVE_SSE2
+                case Level::SSE2:
+                    return toBinarySse2;
+#endif
+                default:
+                    return toBinaryScalar;
+            }
+        }
+    }
+}
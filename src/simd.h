@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VcdFormat {
+    /**
+     * State of one bit of a 4-state value, as packed by Simd::getPackValue().
+     */
+    enum LogicState : uint8_t {
+        Logic0 = 0,
+        Logic1 = 1,
+        LogicX = 2, // also used for 'u' and '-'
+        LogicZ = 3
+    };
+
+    inline LogicState toLogicState(char ch) {
+        switch (ch) {
+            case '0':
+                return Logic0;
+            case '1':
+                return Logic1;
+            case 'z':
+            case 'Z':
+                return LogicZ;
+            default:
+                return LogicX;
+        }
+    }
+
+    inline char toChar(LogicState state) {
+        return "01xz"[state];
+    }
+}
+
+namespace VcdParser {
+    namespace Simd {
+        enum class Level {
+            Scalar,
+            SSE2,
+            AVX2
+        };
+
+        /**
+         * The best instruction set supported by both the build and the CPU, detected once.
+         */
+        Level getSupportedLevel();
+
+        /**
+         * Returns level, or the best supported level below it.
+         */
+        Level clampLevel(Level level);
+
+        /**
+         * Finds the first token delimiter ('\n', '\r', ' ', '\t' or '\0') in [p, end).
+         * @return the delimiter's position, or end if there is none
+         */
+        typedef const char *(*FindDelimiterFunction)(const char *p, const char *end);
+
+        FindDelimiterFunction getFindDelimiter(Level level);
+
+        /**
+         * Finds the first character of [p, end) that isn't a value character, see isValueChar().
+         * @return its position, or end if the whole value is valid
+         */
+        typedef const char *(*FindInvalidValueFunction)(const char *p, const char *end);
+
+        FindInvalidValueFunction getFindInvalidValue(Level level);
+
+        /**
+         * ORs a valid value, most significant bit first, into the packed 2-bit states of
+         * VcdFormat::VectorChanges, (length + 3) / 4 bytes.
+         */
+        typedef void (*PackValueFunction)(uint8_t *states, const char *value, size_t length);
+
+        PackValueFunction getPackValue(Level level);
+
+        /**
+         * Converts a value of only '0' and '1', most significant bit first, into (length + 63) / 64
+         * words, least significant word first.
+         * @return false if the value has other characters, leaving words undefined
+         */
+        typedef bool (*ToBinaryFunction)(uint64_t *words, const char *value, size_t length);
+
+        ToBinaryFunction getToBinary(Level level);
+
+        inline bool isDelimiter(char ch) {
+            switch (ch) {
+                case '\n':
+                case '\r':
+                case ' ':
+                case '\t':
+                case '\0':
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        /**
+         * Whether ch is one of the 4-state value characters 0 1 x X z Z u U -.
+         */
+        inline bool isValueChar(char ch) {
+            switch (ch) {
+                case '0':
+                case '1':
+                case 'x':
+                case 'X':
+                case 'z':
+                case 'Z':
+                case 'u':
+                case 'U':
+                case '-':
+                    return true;
+                default:
+                    return false;
+            }
+        }
+    }
+}
@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: MIT
+
+#include "stats.h"
+
+namespace VcdParser {
+#ifdef VCDPARSER_ENABLE_STATS
+    const bool ParseStats::Enabled = true;
+#else
+    const bool ParseStats::Enabled = false;
+#endif
+
+    void ParseStats::merge(const ParseStats &other) {
+        bytes += other.bytes;
+        tokens += other.tokens;
+        definitionsSeconds += other.definitionsSeconds;
+        simulationSeconds += other.simulationSeconds;
+        timeRecords += other.timeRecords;
+        dumpSections += other.dumpSections;
+        scalarChanges += other.scalarChanges;
+        vectorChanges += other.vectorChanges;
+        realChanges += other.realChanges;
+        skippedChanges += other.skippedChanges;
+        hashedLookups += other.hashedLookups;
+        if (variableChanges.size() < other.variableChanges.size()) {
+            variableChanges.resize(other.variableChanges.size());
+        }
+        for (size_t i = 0; i < other.variableChanges.size(); i++) {
+            variableChanges[i] += other.variableChanges[i];
+        }
+    }
+}
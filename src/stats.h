@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Statistics are only collected when the library is built with VCDPARSER_ENABLE_STATS
+ * (the CMake option of the same name). Otherwise VCDPARSER_STAT() compiles to nothing and
+ * ParseStats stays zero, so the parser's hot paths are unchanged.
+ */
+#ifdef VCDPARSER_ENABLE_STATS
+#define VCDPARSER_STAT(statement) do { statement; } while (false)
+#else
+#define VCDPARSER_STAT(statement) do { } while (false)
+#endif
+
+namespace VcdParser {
+    /**
+     * Counters filled in by VcdParser while it parses, see VcdParser::getStats().
+     */
+    struct ParseStats {
+        /**
+         * Whether the library was built with VCDPARSER_ENABLE_STATS.
+         */
+        static const bool Enabled;
+
+        uint64_t bytes = 0;
+        uint64_t tokens = 0;
+
+        // time spent in parse(), feed() and finish(), by section of the file
+        double definitionsSeconds = 0;
+        double simulationSeconds = 0;
+
+        uint64_t timeRecords = 0;
+        uint64_t dumpSections = 0;
+        uint64_t scalarChanges = 0;
+        uint64_t vectorChanges = 0;
+        uint64_t realChanges = 0;
+        // changes of variables that aren't selected
+        uint64_t skippedChanges = 0;
+        // identifier codes that missed the dense table and were looked up in the hash table
+        uint64_t hashedLookups = 0;
+
+        // changes by variable id
+        std::vector<uint64_t> variableChanges;
+
+        // memory held at the end of the parse; the result's only if no handler was set
+        uint64_t identifierIndexBytes = 0;
+        uint64_t arenaBytes = 0;
+        uint64_t signalListBytes = 0;
+        uint64_t timestampBytes = 0;
+
+        /**
+         * Adds the counters of other, which covers another part of the same input.
+         * The memory figures are kept, they describe the whole parse.
+         */
+        void merge(const ParseStats &other);
+    };
+}
@@ -2,56 +2,118 @@
 
 #include "tokenizer.h"
 
+#include <cstring>
+
+VcdParser::Tokenizer::Tokenizer()
+        : data(nullptr),
+          end(nullptr),
+          p(nullptr),
+          final(false) {
+    setSimdLevel(Simd::getSupportedLevel());
+}
+
 VcdParser::Tokenizer::Tokenizer(const char *data, size_t len)
         : data(data),
+          end(data + len),
           p(data),
-          end(data + len) {
-}
-
-std::string VcdParser::Tokenizer::getNextToken() {
-    while (p < end) { // skip spaces
-        switch (*p) {
-            case '\n':
-                p++;
-                line += 1;
-                column = 0;
-                continue;
-            case '\r':
-            case '\0':
-            case ' ':
-            case '\t':
-                p++;
-                column += 1;
-                continue;
-            default:
-                break;
+          final(true) {
+    setSimdLevel(Simd::getSupportedLevel());
+    tokenStart = data;
+    countedPosition = data;
+}
+
+void VcdParser::Tokenizer::setSimdLevel(Simd::Level level) {
+    findDelimiter = Simd::getFindDelimiter(level);
+}
+
+void VcdParser::Tokenizer::feed(const char *chunk, size_t len) {
+    // the position at the end of the old chunk was located when it ran out
+    chunkLine = countedLine;
+    chunkColumn = countedColumn;
+    baseOffset += end - data;
+    data = chunk;
+    p = chunk;
+    end = chunk + len;
+    countedPosition = chunk;
+    if (!inToken) {
+        tokenStart = chunk;
+    }
+}
+
+void VcdParser::Tokenizer::finish() {
+    final = true;
+}
+
+void VcdParser::Tokenizer::locate(const char *position, size_t &line, size_t &column) const {
+    if (position < countedPosition) {
+        countedPosition = data;
+        countedLine = chunkLine;
+        countedColumn = chunkColumn;
+    }
+    const char *lastNewline = nullptr;
+    const char *it = countedPosition;
+    while (it < position) {
+        auto *newline = static_cast<const char *>(std::memchr(it, '\n', position - it));
+        if (newline == nullptr) {
+            break;
+        }
+        countedLine++;
+        lastNewline = newline;
+        it = newline + 1;
+    }
+    if (lastNewline != nullptr) {
+        countedColumn = position - (lastNewline + 1);
+    } else {
+        countedColumn += position - countedPosition;
+    }
+    countedPosition = position;
+    line = countedLine;
+    column = countedColumn;
+}
+
+VcdParser::TokenView VcdParser::Tokenizer::chunkExhausted() {
+    // carry the position over to the next chunk, this one can't be looked at afterwards
+    size_t line, column;
+    locate(end, line, column);
+    return {};
+}
+
+VcdParser::TokenView VcdParser::Tokenizer::getNextTokenView() {
+    if (inToken) { // continue a token split at the end of the previous chunk
+        const char *tokenEnd = findDelimiter(p, end);
+        pending.append(p, tokenEnd);
+        p = tokenEnd;
+        if (p == end && !final) {
+            return chunkExhausted();
         }
-        break;
-    }
-    lastColumn = column;
-    lastLine = line;
-    const char *tokenStart = p;
-    while (p < end) {
-        switch (*p) {
-            case '\n':
-                line += 1;
-                column = 0;
-            case '\r':
-            case ' ':
-            case '\t':
-            case '\0': {
-                const char *tokenEnd = p;
-                if (*p != '\n') {
-                    column += 1;
-                }
-                p++;
-                return std::string(tokenStart, tokenEnd);
-            }
-            default:
-                p++;
-                column += 1;
-                continue;
+        inToken = false;
+        if (p < end) {
+            p++;
         }
+        return {pending.data(), pending.size()};
+    }
+    while (p < end && Simd::isDelimiter(*p)) { // skip spaces
+        p++;
+    }
+    tokenStart = p;
+    tokenStartFixed = false;
+    if (p == end) {
+        return final ? TokenView() : chunkExhausted();
+    }
+    const char *tokenEnd = findDelimiter(p, end);
+    if (tokenEnd < end) {
+        p = tokenEnd + 1;
+        return {tokenStart, static_cast<size_t>(tokenEnd - tokenStart)};
+    }
+    p = end;
+    if (final) { // last token isn't followed by a delimiter
+        return {tokenStart, static_cast<size_t>(end - tokenStart)};
     }
-    return "";
+    // the token's position has to be known before its chunk goes away
+    locate(tokenStart, tokenStartLine, tokenStartColumn);
+    tokenStartOffset = baseOffset + (tokenStart - data);
+    tokenStartFixed = true;
+    pending.assign(tokenStart, end);
+    inToken = true;
+    return chunkExhausted();
 }
@@ -2,9 +2,66 @@
 
 #pragma once
 
+#include <cstring>
 #include <string>
 
+#include "simd.h"
+
 namespace VcdParser {
+    /**
+     * Non-owning view of a token inside the tokenizer's input buffer.
+     * Only valid as long as the underlying buffer is alive.
+     */
+    struct TokenView {
+        const char *data = nullptr;
+        size_t size = 0;
+
+        TokenView() = default;
+
+        TokenView(const char *data, size_t size)
+                : data(data), size(size) {
+        }
+
+        inline bool empty() const {
+            return size == 0;
+        }
+
+        inline char operator[](size_t i) const {
+            return data[i];
+        }
+
+        inline const char *begin() const {
+            return data;
+        }
+
+        inline const char *end() const {
+            return data + size;
+        }
+
+        inline TokenView substr(size_t pos) const {
+            return pos >= size ? TokenView(data + size, 0) : TokenView(data + pos, size - pos);
+        }
+
+        inline bool operator==(const char *str) const {
+            size_t len = std::strlen(str);
+            return len == size && std::memcmp(data, str, len) == 0;
+        }
+
+        inline bool operator!=(const char *str) const {
+            return !(*this == str);
+        }
+
+        inline std::string toString() const {
+            return std::string(data, size);
+        }
+    };
+
+    /**
+     * Splits VCD text into whitespace separated tokens.
+     *
+     * Delimiters are searched with SIMD instructions where available. Line and column
+     * numbers aren't tracked while scanning; they are computed from the offset when asked for.
+     */
     class Tokenizer {
         // std::string::iterator it;
         // std::string::iterator end;
@@ -12,30 +69,135 @@ namespace VcdParser {
         const char *data;
         const char *end;
         const char *p;
+        size_t baseOffset = 0;
+
+        Simd::FindDelimiterFunction findDelimiter;
+
+        // set once no more input follows the current buffer
+        bool final;
+        // a token reached the end of a chunk and is continued by the next one
+        bool inToken = false;
+        std::string pending;
+
+        // start of the last token, or its line and column if its chunk is gone
+        const char *tokenStart = nullptr;
+        bool tokenStartFixed = false;
+        size_t tokenStartOffset = 0;
+        size_t tokenStartLine = 1;
+        size_t tokenStartColumn = 0;
+
+        // position of the start of the current chunk, in streaming mode
+        size_t chunkLine = 1;
+        size_t chunkColumn = 0;
+        // cache of the last position located in the current chunk
+        mutable const char *countedPosition = nullptr;
+        mutable size_t countedLine = 1;
+        mutable size_t countedColumn = 0;
+
+        void locate(const char *position, size_t &line, size_t &column) const;
+
+        TokenView chunkExhausted();
 
-        size_t line = 1;
-        size_t column = 0;
-        size_t lastLine = 1;
-        size_t lastColumn = 0;
     public:
+        /**
+         * Creates a tokenizer that receives its input in chunks via feed().
+         */
+        Tokenizer();
+
         explicit Tokenizer(const char *data, size_t len);
 
-        std::string getNextToken();
+        /**
+         * Selects the instruction set used to find delimiters, for comparing implementations.
+         * Levels the CPU doesn't support fall back to the best supported one.
+         */
+        void setSimdLevel(Simd::Level level);
+
+        /**
+         * Continues tokenizing with the next chunk of input. The previous chunk must have been
+         * consumed, i.e. getNextTokenView() returned an empty view; it's no longer referenced afterwards.
+         */
+        void feed(const char *chunk, size_t len);
+
+        /**
+         * Marks the end of the input, so a trailing token without a delimiter is returned.
+         */
+        void finish();
+
+        inline bool isStreaming() const {
+            return !final;
+        }
+
+        /**
+         * Returns the next token as a view, or an empty view once the current input is exhausted.
+         * The view points into the input buffer, or into an internal buffer if the token was split
+         * across chunks; it's valid until the next call.
+         */
+        TokenView getNextTokenView();
+
+        std::string getNextToken() {
+            return getNextTokenView().toString();
+        }
+
+        /**
+         * Continues at offset of the input, for a tokenizer created with the whole input.
+         * Line and column numbers stay those of the whole input.
+         */
+        void seek(size_t offset) {
+            p = data + offset;
+            tokenStart = p;
+        }
 
-        inline size_t getLine() const {
+        inline size_t getOffset() const {
+            return baseOffset + (p - data);
+        }
+
+        /**
+         * Offset of the start of the last token.
+         */
+        inline size_t getLastOffset() const {
+            return tokenStartFixed ? tokenStartOffset : baseOffset + (tokenStart - data);
+        }
+
+        /**
+         * Line (from 1) of the current position.
+         */
+        size_t getLine() const {
+            size_t line, column;
+            locate(p, line, column);
             return line;
         }
 
-        inline size_t getColumn() const {
+        /**
+         * Column (from 0) of the current position.
+         */
+        size_t getColumn() const {
+            size_t line, column;
+            locate(p, line, column);
             return column;
         }
 
-        inline size_t getLastLine() const {
-            return lastLine;
+        /**
+         * Line of the start of the last token.
+         */
+        size_t getLastLine() const {
+            if (tokenStartFixed) {
+                return tokenStartLine;
+            }
+            size_t line, column;
+            locate(tokenStart, line, column);
+            return line;
         }
 
-        inline size_t getLastColumn() const {
-            return lastColumn;
+        /**
+         * Column of the start of the last token.
+         */
+        size_t getLastColumn() const {
+            if (tokenStartFixed) {
+                return tokenStartColumn;
+            }
+            size_t line, column;
+            locate(tokenStart, line, column);
+            return column;
         }
     };
 }
@@ -3,6 +3,7 @@
 #include "utils.h"
 
 #include <cstdarg>
+#include <cstring>
 #include <stdexcept>
 
 std::string VcdParser::Utils::formatString(const char *fmt, va_list va) {
@@ -15,5 +16,42 @@ std::string VcdParser::Utils::formatString(const char *fmt, va_list va) {
     std::string str;
     str.resize(size);
     vsnprintf(const_cast<char *>(str.data()), size, fmt, va2);
+    va_end(va2);
+    // without the terminating null character
+    str.resize(size - 1);
     return str;
 }
+
+void VcdParser::Utils::locateOffset(const char *text, size_t offset, size_t &line, size_t &column) {
+    line = 1;
+    const char *lineStart = text;
+    const char *end = text + offset;
+    const char *it = text;
+    while (it < end) {
+        auto *newline = static_cast<const char *>(std::memchr(it, '\n', end - it));
+        if (newline == nullptr) {
+            break;
+        }
+        line++;
+        lineStart = newline + 1;
+        it = newline + 1;
+    }
+    column = end - lineStart;
+}
+
+const char *VcdParser::Utils::findTimeLine(const char *begin, const char *position, const char *end) {
+    if (position > begin && position < end && position[-1] == '\n' && *position == '#') {
+        return position;
+    }
+    while (position < end) {
+        auto *newline = static_cast<const char *>(std::memchr(position, '\n', end - position));
+        if (newline == nullptr || newline + 1 >= end) {
+            return end;
+        }
+        if (newline[1] == '#') {
+            return newline + 1;
+        }
+        position = newline + 1;
+    }
+    return end;
+}
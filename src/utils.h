@@ -2,10 +2,47 @@
 
 #pragma once
 
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace VcdParser {
     namespace Utils {
         std::string formatString(const char *fmt, va_list va);
+
+        /**
+         * Line (from 1) and column (from 0) of offset in text.
+         */
+        void locateOffset(const char *text, size_t offset, size_t &line, size_t &column);
+
+        /**
+         * Finds the start of the first line beginning with '#' at or after position.
+         * @param begin start of the text, position isn't looked at before it
+         * @return the line, or end if there is none
+         */
+        const char *findTimeLine(const char *begin, const char *position, const char *end);
+
+        /**
+         * Parses the decimal digits at the start of data.
+         * @return the number of digits, 0 if there are none or the number doesn't fit into
+         * 64 bits, in which case result is left unchanged
+         */
+        inline size_t parseNumber(const char *data, size_t size, uint64_t &result) {
+            uint64_t value = 0;
+            size_t i = 0;
+            for (; i < size; i++) {
+                unsigned digit = static_cast<unsigned char>(data[i]) - '0';
+                if (digit > 9) {
+                    break;
+                }
+                if (value > (UINT64_MAX - digit) / 10) {
+                    return 0;
+                }
+                value = value * 10 + digit;
+            }
+            result = value;
+            return i;
+        }
     }
 }
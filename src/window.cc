@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: MIT
+
+#include "libvcdparser.h"
+#include "utils.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace VcdParser {
+    namespace {
+        /**
+         * Keeps the last value of every variable, to rebuild the values at the start of a window.
+         */
+        class StateTracker : public VcdHandler {
+            enum ValueKind : uint8_t {
+                Unknown,
+                Scalar,
+                Vector,
+                RealValue
+            };
+
+            std::vector<ValueKind> kinds;
+            std::vector<std::string> values;
+            std::vector<double> reals;
+
+        public:
+            explicit StateTracker(size_t variableCount)
+                    : kinds(variableCount, Unknown),
+                      values(variableCount),
+                      reals(variableCount) {
+            }
+
+            void onScalarChange(uint32_t id, char value) override {
+                kinds[id] = Scalar;
+                values[id].assign(1, value);
+            }
+
+            void onVectorChange(uint32_t id, const TokenView &value) override {
+                kinds[id] = Vector;
+                values[id].assign(value.data, value.size);
+            }
+
+            void onRealChange(uint32_t id, double value) override {
+                kinds[id] = RealValue;
+                reals[id] = value;
+            }
+
+            /**
+             * Reports the values at time as a $dumpall section.
+             */
+            void replay(VcdHandler &handler, uint64_t time) const {
+                handler.onTime(time);
+                handler.onDumpSection(DumpSection::Dumpall);
+                for (uint32_t id = 0; id < kinds.size(); id++) {
+                    switch (kinds[id]) {
+                        case Scalar:
+                            handler.onScalarChange(id, values[id][0]);
+                            break;
+                        case Vector:
+                            handler.onVectorChange(id, TokenView(values[id].data(), values[id].size()));
+                            break;
+                        case RealValue:
+                            handler.onRealChange(id, reals[id]);
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                handler.onDumpSectionEnd(DumpSection::Dumpall);
+            }
+        };
+
+        // time of a line starting with '#', invalid times are left for the parser to report;
+        // a time that doesn't fit into 64 bits comes after all others, so the parser reaches it
+        uint64_t readTime(const char *line, const char *end) {
+            uint64_t time = UINT64_MAX; // kept by parseNumber() on overflow
+            Utils::parseNumber(line + 1, end - line - 1, time);
+            return time;
+        }
+
+        bool isCommand(const char *token, const char *body, const char *end, const char *command) {
+            size_t length = std::strlen(command);
+            return (token == body || Simd::isDelimiter(token[-1]))
+                   && static_cast<size_t>(end - token) >= length && std::memcmp(token, command, length) == 0
+                   && (end - token == static_cast<ptrdiff_t>(length) || Simd::isDelimiter(token[length]));
+        }
+
+        /**
+         * Whether line is part of the text of a $comment, that is the last $comment before it
+         * isn't closed by a $end. The scan backward stops at from, a position known to be
+         * outside of comments, and after CommentScanSize bytes, beyond which a comment is taken
+         * to have ended.
+         */
+        bool isInComment(const char *body, const char *from, const char *line) {
+            const ptrdiff_t CommentScanSize = 1024 * 1024;
+            if (line - from > CommentScanSize) {
+                from = line - CommentScanSize;
+            }
+            for (const char *it = line; it > from;) {
+                if (*--it != '$') {
+                    continue;
+                }
+                if (isCommand(it, body, line, "$end")) {
+                    return false;
+                }
+                if (isCommand(it, body, line, "$comment")) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Finds the first line starting with '#' at or after position that isn't part of a
+         * comment, with from as for isInComment().
+         */
+        const char *findRecordLine(const char *input, const char *body, const char *from, const char *position,
+                                   const char *end) {
+            for (const char *line = Utils::findTimeLine(input, position, end); line != end;) {
+                if (!isInComment(body, from, line)) {
+                    return line;
+                }
+                // continue after the $end of the comment
+                const char *it = line;
+                while (it != end && !(*it == '$' && isCommand(it, body, end, "$end"))) {
+                    it++;
+                }
+                from = it;
+                line = Utils::findTimeLine(input, it, end);
+            }
+            return end;
+        }
+
+        /**
+         * Finds the first line starting with '#' whose time is at least time.
+         */
+        const char *findTimeLineAfter(const char *input, const char *body, const char *end, uint64_t time) {
+            // times never decrease, so the time of the first # line after a position grows with it
+            const ptrdiff_t ScanSize = 64 * 1024;
+            const char *low = body;
+            const char *high = end;
+            while (high - low > ScanSize) {
+                const char *middle = low + (high - low) / 2;
+                const char *line = findRecordLine(input, body, low, middle, end);
+                if (line == end || readTime(line, end) >= time) {
+                    high = middle;
+                } else {
+                    low = line + 1;
+                }
+            }
+            for (const char *line = findRecordLine(input, body, low, low, end); line != end;
+                 line = findRecordLine(input, body, line, line + 1, end)) {
+                if (readTime(line, end) >= time) {
+                    return line;
+                }
+            }
+            return end;
+        }
+
+        /**
+         * Finds the # line that precedes the last $dumpall or $dumpvars section before position,
+         * where parsing can start to rebuild the values at position. Only the CheckpointScanSize
+         * bytes before position are searched; replaying from body is always correct, a
+         * checkpoint just shortens it.
+         * @return the line, or body if there is none
+         */
+        const char *findCheckpoint(const char *body, const char *position) {
+            const ptrdiff_t CheckpointScanSize = 16 * 1024 * 1024;
+            const char *limit = position - body > CheckpointScanSize ? position - CheckpointScanSize : body;
+            // a section found while scanning backward is confirmed by a $end before it, or by
+            // reaching body; a $comment before it means the section was part of its text
+            const char *section = nullptr;
+            const char *it = position;
+            while (it > limit) {
+                if (*--it != '$') {
+                    continue;
+                }
+                if (isCommand(it, body, position, "$end")) {
+                    if (section != nullptr) {
+                        break;
+                    }
+                } else if (isCommand(it, body, position, "$comment")) {
+                    section = nullptr;
+                } else if (section == nullptr && (isCommand(it, body, position, "$dumpall")
+                                                  || isCommand(it, body, position, "$dumpvars"))) {
+                    section = it;
+                }
+            }
+            if (section == nullptr || (it == limit && limit != body)) {
+                return body;
+            }
+            for (it = section; it > limit && !(*it == '#' && it[-1] == '\n' && !isInComment(body, limit, it)); it--) {
+            }
+            return it == limit ? body : it;
+        }
+    }
+}
+
+void VcdParser::VcdParser::setTimeWindow(uint64_t begin, uint64_t end) {
+    if (begin > end) {
+        throw std::invalid_argument("time window begins after its end");
+    }
+    windowed = true;
+    windowBegin = begin;
+    timeLimit = end;
+}
+
+void VcdParser::VcdParser::parseWindow() {
+    const char *body = input + tokenizer.getOffset();
+    const char *end = input + inputSize;
+    const char *start = findTimeLineAfter(input, body, end, windowBegin);
+    const char *checkpoint = findCheckpoint(body, start);
+
+    // rebuild the values at the start of the window, without storing the changes before it
+    uint64_t windowEnd = timeLimit;
+    timeLimit = UINT64_MAX;
+    StateTracker tracker(varSizes.size());
+    VcdHandler *windowHandler = handler;
+    handler = &tracker;
+    try {
+        tokenizer = Tokenizer(input, start - input);
+        tokenizer.seek(checkpoint - input);
+        parseTokens();
+    } catch (...) {
+        handler = windowHandler;
+        throw;
+    }
+    handler = windowHandler;
+    tracker.replay(*getHandler(), windowBegin);
+
+    tokenizer = Tokenizer(input, inputSize);
+    tokenizer.seek(start - input);
+    timeLimit = windowEnd;
+    parseTokens();
+}
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: MIT
+
+// Switching activity of a small file worked out by hand, and of a random file measured
+// while parsing against measureActivity() in every storage mode.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <activity.h>
+#include <libvcdparser.h>
+#include <query.h>
+
+#include "check.h"
+
+// for comparing whole results, found by argument dependent lookup
+namespace VcdFormat {
+    bool operator==(const BitActivity &a, const BitActivity &b) {
+        return a.toggles == b.toggles && a.rising == b.rising && a.falling == b.falling
+               && a.occupancy[0] == b.occupancy[0] && a.occupancy[1] == b.occupancy[1]
+               && a.occupancy[2] == b.occupancy[2] && a.occupancy[3] == b.occupancy[3];
+    }
+
+    bool operator==(const Activity &a, const Activity &b) {
+        return a.transitions == b.transitions && a.bits == b.bits;
+    }
+}
+
+namespace {
+    using VcdFormat::StorageMode;
+
+    const std::string Header = "$timescale 1ns $end\n"
+                               "$scope module top $end\n"
+                               "$var wire 1 ! clk $end\n"
+                               "$var wire 2 \" bus $end\n"
+                               "$var real 64 # r $end\n"
+                               "$upscope $end\n"
+                               "$enddefinitions $end\n";
+
+    VcdFormat::VcdFile parse(const std::string &input, StorageMode mode) {
+        VcdParser::VcdParser parser(input);
+        parser.setStorageMode(mode);
+        parser.parse();
+        VcdFormat::VcdFile file = std::move(parser.getResult());
+        if (mode == StorageMode::Indexed) {
+            for (VcdFormat::Variable *variable : file.variableList) {
+                file.load(*variable);
+            }
+        }
+        return file;
+    }
+
+    void checkByHand() {
+        std::string input = Header + "#0\n0!\nb0x \"\nr1 #\n"
+                                     "#10\n1!\nb11 \"\nr1 #\n"
+                                     "#20\n0!\nr2 #\n"
+                                     "#25\nz!\nb11 \"\n"
+                                     "#30\n1!\nb10 \"\nr2.5 #\n"
+                                     "#40\n";
+        static const StorageMode modes[] = {StorageMode::PerBit, StorageMode::Packed, StorageMode::Indexed};
+        for (StorageMode mode : modes) {
+            VcdFormat::VcdFile file = parse(input, mode);
+            const VcdFormat::Variable &clk = *file.findVariable("top.clk");
+            const VcdFormat::Variable &bus = *file.findVariable("top.bus");
+            const VcdFormat::Variable &real = *file.findVariable("top.r");
+
+            VcdFormat::Activity activity = VcdFormat::measureActivity(file, clk);
+            // 0 -> 1 -> 0 -> z -> 1, the first 0 isn't a change
+            CHECK(activity.transitions == 4);
+            CHECK(activity.bits.size() == 1);
+            CHECK(activity.bits[0].toggles == 4);
+            CHECK(activity.bits[0].rising == 3); // 0 -> 1, 0 -> z and z -> 1
+            CHECK(activity.bits[0].falling == 1);
+            CHECK(activity.bits[0].occupancy[VcdFormat::Logic0] == 15);
+            CHECK(activity.bits[0].occupancy[VcdFormat::Logic1] == 20);
+            CHECK(activity.bits[0].occupancy[VcdFormat::LogicZ] == 5);
+            CHECK(activity.bits[0].getDutyCycle() == 0.5);
+
+            activity = VcdFormat::measureActivity(file, bus);
+            // 0x -> 11 -> 11 (no transition) -> 10
+            CHECK(activity.transitions == 2);
+            CHECK(activity.bits[0].toggles == 2 && activity.bits[0].rising == 1 && activity.bits[0].falling == 1);
+            CHECK(activity.bits[1].toggles == 1 && activity.bits[1].rising == 1);
+            CHECK(activity.bits[0].occupancy[VcdFormat::LogicX] == 10);
+
+            // 1 -> 1 -> 2 -> 2.5, the first change and the repeated value aren't transitions
+            activity = VcdFormat::measureActivity(file, real);
+            CHECK(activity.transitions == 2 && activity.bits.empty());
+            CHECK(VcdFormat::measureActivity(file, real, 0, 20).transitions == 0);
+            CHECK(VcdFormat::measureActivity(file, real, 20, 30).transitions == 1);
+
+            // changes at begin count, changes at end don't
+            activity = VcdFormat::measureActivity(file, clk, 10, 25);
+            CHECK(activity.transitions == 2);
+            CHECK(activity.bits[0].occupancy[VcdFormat::Logic1] == 10);
+            CHECK(activity.bits[0].occupancy[VcdFormat::Logic0] == 5);
+
+            VcdFormat::VcdQuery query(file);
+            uint64_t time = 0;
+            CHECK(VcdFormat::findNextEdge(query, clk, 0, VcdFormat::Edge::Rising, 10, time) && time == 25);
+            CHECK(VcdFormat::findNextEdge(query, clk, 0, VcdFormat::Edge::Falling, 0, time) && time == 20);
+            CHECK(VcdFormat::findNextEdge(query, bus, 0, VcdFormat::Edge::Any, 10, time) && time == 30);
+            CHECK(!VcdFormat::findNextEdge(query, bus, 1, VcdFormat::Edge::Falling, 0, time));
+            CHECK(!VcdFormat::findNextEdge(query, real, 0, VcdFormat::Edge::Any, 0, time));
+        }
+    }
+
+    // splitmix64
+    uint64_t nextRandom(uint64_t &state) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    void checkHandler() {
+        uint64_t state = 1;
+        std::string input = "$timescale 1ns $end\n"
+                            "$var wire 1 ! a $end\n"
+                            "$var wire 7 \" b $end\n"
+                            "$var wire 33 # c $end\n"
+                            "$var real 64 $ r $end\n"
+                            "$enddefinitions $end\n";
+        static const char values[] = "01xz";
+        uint64_t time = 0;
+        for (int i = 0; i < 2000; i++) {
+            input += '#' + std::to_string(time += 1 + nextRandom(state) % 7) + '\n';
+            if (nextRandom(state) % 2 == 0) {
+                input += values[nextRandom(state) % 4];
+                input += "!\n";
+            }
+            static const char *const vectors[] = {"\"", "#"};
+            static const size_t widths[] = {7, 33};
+            for (int v = 0; v < 2; v++) {
+                if (nextRandom(state) % 3 == 0) {
+                    // shorter values are left-extended
+                    size_t length = 1 + nextRandom(state) % widths[v];
+                    input += 'b';
+                    for (size_t bit = 0; bit < length; bit++) {
+                        input += values[nextRandom(state) % (nextRandom(state) % 4 == 0 ? 4 : 2)];
+                    }
+                    input += std::string(" ") + vectors[v] + '\n';
+                }
+            }
+            if (nextRandom(state) % 4 == 0) {
+                input += 'r' + std::to_string(nextRandom(state) % 3) + " $\n";
+            }
+        }
+
+        VcdFormat::ActivityHandler handler;
+        VcdParser::VcdParser parser(input);
+        parser.setHandler(handler);
+        parser.parse();
+        static const StorageMode modes[] = {StorageMode::PerBit, StorageMode::Packed, StorageMode::Indexed};
+        for (StorageMode mode : modes) {
+            VcdFormat::VcdFile file = parse(input, mode);
+            for (size_t id = 0; id < file.variableList.size(); id++) {
+                CHECK(VcdFormat::measureActivity(file, *file.variableList[id]) == handler.getActivities()[id]);
+            }
+        }
+    }
+}
+
+int main() {
+    checkByHand();
+    checkHandler();
+    return VcdTest::checkResult();
+}
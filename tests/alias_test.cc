@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: MIT
+
+// Variables declared with the same identifier code in several scopes, in every storage mode
+// and with selections that leave out some of them.
+
+#include <string>
+#include <vector>
+
+#include <activity.h>
+#include <libvcdparser.h>
+#include <query.h>
+
+#include "check.h"
+
+namespace {
+    using VcdFormat::StorageMode;
+
+    const StorageMode Modes[] = {StorageMode::PerBit, StorageMode::Packed, StorageMode::Indexed};
+
+    // clk and bus are connected through three levels, the ports come after their first use
+    const std::string Input = "$timescale 1ns $end\n"
+                              "$scope module top $end\n"
+                              "$var wire 1 ! clk $end\n"
+                              "$var wire 4 \" bus $end\n"
+                              "$scope module cpu $end\n"
+                              "$var wire 1 ! clk_in $end\n"
+                              "$var wire 1 # en $end\n"
+                              "$scope module alu $end\n"
+                              "$var wire 4 \" operand $end\n"
+                              "$var wire 1 ! clk $end\n"
+                              "$upscope $end\n"
+                              "$upscope $end\n"
+                              "$var wire 4 \" bus_copy $end\n"
+                              "$upscope $end\n"
+                              "$enddefinitions $end\n"
+                              "#0\n$dumpvars\n0!\nb0 \"\n1#\n$end\n"
+                              "#5\n1!\nb1x \"\n"
+                              "#10\n0!\n0#\n"
+                              "#15\n1!\nb1010 \"\n"
+                              "#20\n0!\n";
+
+    VcdFormat::VcdFile parse(StorageMode mode, const std::vector<std::string> &names) {
+        VcdParser::VcdParser parser(Input);
+        parser.setStorageMode(mode);
+        for (const std::string &name : names) {
+            parser.selectByName(name);
+        }
+        parser.parse();
+        VcdFormat::VcdFile file = std::move(parser.getResult());
+        if (mode == StorageMode::Indexed) {
+            for (VcdFormat::Variable *variable : file.variableList) {
+                file.load(*variable);
+            }
+        }
+        return file;
+    }
+
+    std::string getValues(const VcdFormat::VcdFile &file, const std::string &path) {
+        VcdFormat::VcdQuery query(file);
+        std::string values;
+        for (uint64_t time = 0; time <= 20; time += 5) {
+            values += query.valueAt(*file.findVariable(path), time) + ' ';
+        }
+        return values;
+    }
+
+    void checkShared() {
+        for (StorageMode mode : Modes) {
+            VcdFormat::VcdFile file = parse(mode, {});
+            if (!CHECK(file.variableList.size() == 7)) {
+                continue;
+            }
+            // every alias keeps its name and scope and refers to the first declaration
+            VcdFormat::Variable &clk = *file.findVariable("top.clk");
+            static const char *const clkAliases[] = {"top.cpu.clk_in", "top.cpu.alu.clk"};
+            for (const char *path : clkAliases) {
+                VcdFormat::Variable &alias = *file.findVariable(path);
+                CHECK(alias.aliasOf == &clk && &alias.getCanonical() == &clk);
+                CHECK(file.getPath(alias) == path && file.getPath(*alias.scope) + '.' + alias.name.str() == path);
+                CHECK(alias.width == 1 && alias.identifier.str() == "!");
+                // the changes are stored once
+                CHECK(alias.signalLists.empty() && alias.changes.count == 0 && alias.offsets.count == 0);
+                CHECK(getValues(file, path) == "0 1 0 1 0 ");
+            }
+            CHECK(clk.aliasOf == nullptr && getValues(file, "top.clk") == "0 1 0 1 0 ");
+            static const char *const busAliases[] = {"top.bus", "top.cpu.alu.operand", "top.bus_copy"};
+            for (const char *path : busAliases) {
+                CHECK(getValues(file, path) == "0000 001x 001x 1010 1010 ");
+            }
+            CHECK(file.findVariable("top.bus_copy")->aliasOf == file.findVariable("top.bus"));
+
+            VcdFormat::Activity activity = VcdFormat::measureActivity(file, *file.findVariable("top.cpu.alu.clk"));
+            CHECK(activity.transitions == 4 && activity.bits.size() == 1 && activity.bits[0].rising == 2);
+        }
+    }
+
+    void checkSelected() {
+        for (StorageMode mode : Modes) {
+            // the first declaration isn't selected, so the alias holds the changes
+            VcdFormat::VcdFile file = parse(mode, {"top.cpu.clk_in"});
+            CHECK(file.variableList.size() == 1 && file.findVariable("top.clk") == nullptr);
+            VcdFormat::Variable *clkIn = file.findVariable("top.cpu.clk_in");
+            if (CHECK(clkIn != nullptr)) {
+                CHECK(clkIn->aliasOf == nullptr && getValues(file, "top.cpu.clk_in") == "0 1 0 1 0 ");
+            }
+
+            // the first selected declaration holds the changes of the later ones
+            file = parse(mode, {"top.cpu.alu.*", "top.bus_copy", "top.cpu.clk_in"});
+            CHECK(file.variableList.size() == 4 && file.findVariable("top.bus") == nullptr);
+            VcdFormat::Variable *operand = file.findVariable("top.cpu.alu.operand");
+            VcdFormat::Variable *copy = file.findVariable("top.bus_copy");
+            VcdFormat::Variable *alu = file.findVariable("top.cpu.alu.clk");
+            clkIn = file.findVariable("top.cpu.clk_in");
+            if (CHECK(operand != nullptr && copy != nullptr && alu != nullptr && clkIn != nullptr)) {
+                CHECK(operand->aliasOf == nullptr && copy->aliasOf == operand);
+                CHECK(clkIn->aliasOf == nullptr && alu->aliasOf == clkIn);
+                CHECK(getValues(file, "top.bus_copy") == "0000 001x 001x 1010 1010 ");
+                CHECK(getValues(file, "top.cpu.alu.clk") == "0 1 0 1 0 ");
+            }
+        }
+    }
+
+    /**
+     * Records the variables and aliases the parser reports.
+     */
+    class DefinitionLog : public VcdParser::VcdHandler {
+    public:
+        std::string log;
+
+        void onVar(uint32_t id, const VcdParser::VarDefinition &var) override {
+            log += "var " + std::to_string(id) + ' ' + var.name + '\n';
+        }
+
+        void onAlias(uint32_t id, const VcdParser::VarDefinition &var) override {
+            log += "alias " + std::to_string(id) + ' ' + var.name + '\n';
+        }
+
+        void onScalarChange(uint32_t id, char value) override {
+            log += std::to_string(id) + value;
+        }
+    };
+
+    void checkHandler() {
+        DefinitionLog handler;
+        VcdParser::VcdParser parser(Input);
+        parser.setHandler(handler);
+        // '*' also selects the variables of top.cpu.alu
+        parser.selectByName("top.cpu.*");
+        parser.parse();
+        // changes of an identifier code are reported once, for the id of its first selected variable
+        CHECK(handler.log == "var 0 clk_in\nvar 1 en\nvar 2 operand\nalias 0 clk\n00110100100100");
+    }
+}
+
+int main() {
+    checkShared();
+    checkSelected();
+    checkHandler();
+    return VcdTest::checkResult();
+}
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: MIT
+
+// Round trips through the cache, and corrupt caches loaded without verifying the checksum.
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cache.h>
+#include <libvcdparser.h>
+#include <query.h>
+
+#include "check.h"
+
+namespace {
+    const char *const Path = "cache_test.cache";
+
+    const std::string Input = "$timescale 1ns $end\n"
+                              "$scope module top $end\n"
+                              "$var wire 1 ! clk $end\n"
+                              "$var wire 8 \" data $end\n"
+                              "$var wire 8 \" alias $end\n"
+                              "$var real 64 # r $end\n"
+                              "$var realtime 64 $ unchanged $end\n"
+                              "$upscope $end\n"
+                              "$enddefinitions $end\n"
+                              "#0\n0!\nb0 \"\nr0 #\n"
+                              "#10\n1!\nb1010x \"\n"
+                              "#20\n0!\nr2.5 #\n"
+                              "#300\n1!\nbz \"\n";
+
+    std::vector<std::string> getValues(const VcdFormat::VcdFile &file) {
+        VcdFormat::VcdQuery query(file);
+        std::vector<std::string> values;
+        for (const VcdFormat::Variable *variable : file.variableList) {
+            values.push_back(std::to_string(variable->width) + ' ' + std::to_string(variable->type));
+        }
+        for (uint64_t time : file.timestamps) {
+            std::vector<std::string> snapshot = query.snapshotAt(time);
+            values.insert(values.end(), snapshot.begin(), snapshot.end());
+        }
+        return values;
+    }
+
+    std::string readFile() {
+        std::ifstream in(Path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::string &contents) {
+        std::ofstream out(Path, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    uint64_t readWord(const std::string &contents, size_t offset) {
+        uint64_t value = 0;
+        contents.copy(reinterpret_cast<char *>(&value), sizeof(value), offset);
+        return value;
+    }
+
+    void checkRoundTrip() {
+        static const VcdFormat::StorageMode modes[] = {VcdFormat::StorageMode::PerBit,
+                                                       VcdFormat::StorageMode::Packed};
+        for (VcdFormat::StorageMode mode : modes) {
+            VcdParser::VcdParser parser(Input);
+            parser.setStorageMode(mode);
+            parser.parse();
+            std::vector<std::string> expected = getValues(parser.getResult());
+            VcdFormat::Cache::save(parser.getResult(), Path);
+            CHECK(getValues(VcdFormat::Cache::load(Path, true)) == expected);
+            CHECK(getValues(VcdFormat::Cache::load(Path, false)) == expected);
+            VcdFormat::VcdFile loaded = VcdFormat::Cache::load(Path);
+            CHECK(VcdFormat::VcdQuery(loaded).valueAt(*loaded.findVariable("top.unchanged"), 10) == "x");
+        }
+        // empty columns and blobs
+        std::string empty = "$timescale 1ns $end\n$enddefinitions $end\n";
+        VcdParser::VcdParser parser(empty);
+        parser.parse();
+        VcdFormat::Cache::save(parser.getResult(), Path);
+        CHECK(VcdFormat::Cache::load(Path, true).variableList.empty());
+    }
+
+    // the payload after the 32 byte header: meta column, timestamps, 13 variable and
+    // 5 scope columns, then the strings and the time deltas
+    size_t getDeltasOffset(const std::string &contents) {
+        const size_t payload = 32;
+        uint64_t timestampCount = readWord(contents, payload + 3 * 8);
+        uint64_t variableCount = readWord(contents, payload + 4 * 8);
+        uint64_t stringsSize = readWord(contents, payload + 9 * 8);
+        uint64_t scopeCount = readWord(contents, payload + 13 * 8);
+        return payload + 8 * (14 + timestampCount + 13 * variableCount + 5 * scopeCount)
+               + (stringsSize + 7) / 8 * 8;
+    }
+
+    void checkCorrupt() {
+        VcdParser::VcdParser parser(Input);
+        parser.setStorageMode(VcdFormat::StorageMode::Packed);
+        parser.parse();
+        VcdFormat::Cache::save(parser.getResult(), Path);
+        std::string contents = readFile();
+        size_t deltas = getDeltasOffset(contents);
+        uint64_t deltasSize = readWord(contents, 32 + 10 * 8);
+        if (!CHECK(deltasSize >= 2 && deltas + deltasSize <= contents.size())) {
+            return;
+        }
+        // a delta past the last timestamp, an unterminated varint and a missing change
+        static const char replacements[][2] = {{0, 100}, {0, '\x80'}, {'\x80', 1}};
+        for (const auto &replacement : replacements) {
+            std::string corrupt = contents;
+            corrupt[deltas + deltasSize - 2] = replacement[0];
+            corrupt[deltas + deltasSize - 1] = replacement[1];
+            writeFile(corrupt);
+            CHECK_THROWS(std::runtime_error, VcdFormat::Cache::load(Path, false));
+            CHECK_THROWS(std::runtime_error, VcdFormat::Cache::load(Path, true));
+        }
+        // a change count beyond the states of the variable
+        std::string corrupt = contents;
+        size_t changeCounts = 32 + 8 * (14 + readWord(contents, 32 + 3 * 8) + 5 * readWord(contents, 32 + 4 * 8));
+        corrupt[changeCounts + 8] = 100;
+        writeFile(corrupt);
+        CHECK_THROWS(std::runtime_error, VcdFormat::Cache::load(Path, false));
+    }
+}
+
+int main() {
+    checkRoundTrip();
+    checkCorrupt();
+    std::remove(Path);
+    return VcdTest::checkResult();
+}
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdio>
+
+/**
+ * Minimal checks for the test executables: a failed check is reported and makes the
+ * test return 1 from checkResult(), the following checks still run.
+ */
+namespace VcdTest {
+    inline int &failures() {
+        static int count = 0;
+        return count;
+    }
+
+    inline bool report(bool passed, const char *file, int line, const char *condition) {
+        if (!passed) {
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+            failures()++;
+        }
+        return passed;
+    }
+
+    inline int checkResult() {
+        if (failures() != 0) {
+            std::fprintf(stderr, "%d checks failed\n", failures());
+            return 1;
+        }
+        return 0;
+    }
+}
+
+// evaluates to whether condition holds, to stop loops after the first failure
+#define CHECK(condition) VcdTest::report(static_cast<bool>(condition), __FILE__, __LINE__, #condition)
+
+#define CHECK_THROWS(exception, statement) \
+    do { \
+        bool thrown = false; \
+        try { \
+            statement; \
+        } catch (const exception &) { \
+            thrown = true; \
+        } \
+        VcdTest::report(thrown, __FILE__, __LINE__, #statement " throws " #exception); \
+    } while (0)
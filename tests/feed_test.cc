@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: MIT
+
+// Input fed in chunks of every size and split at every position, against parsing it as a
+// whole.
+
+#include <string>
+#include <vector>
+
+#include <libvcdparser.h>
+#include <query.h>
+
+#include "check.h"
+
+namespace {
+    using VcdFormat::StorageMode;
+
+    /**
+     * Writes every event into one string, so two parses can be compared as a whole.
+     */
+    class EventLog : public VcdParser::VcdHandler {
+    public:
+        std::string log;
+
+        void onHeader(const VcdFormat::Header &header) override {
+            log += "header " + header.date + '|' + header.version + '\n';
+        }
+
+        void onScope(uint32_t id, const VcdParser::ScopeDefinition &scope) override {
+            log += "scope " + std::to_string(id) + ' ' + scope.type + ' ' + scope.name + '\n';
+        }
+
+        void onVar(uint32_t id, const VcdParser::VarDefinition &var) override {
+            log += "var " + std::to_string(id) + ' ' + std::to_string(var.size) + ' ' + var.identifier + ' '
+                   + var.name + '\n';
+        }
+
+        void onTime(uint64_t time) override {
+            log += '#' + std::to_string(time) + '\n';
+        }
+
+        void onDumpSection(VcdParser::DumpSection section) override {
+            log += "begin " + std::to_string(static_cast<int>(section)) + '\n';
+        }
+
+        void onDumpSectionEnd(VcdParser::DumpSection section) override {
+            log += "end " + std::to_string(static_cast<int>(section)) + '\n';
+        }
+
+        void onScalarChange(uint32_t id, char value) override {
+            log += std::to_string(id) + ' ' + value + '\n';
+        }
+
+        void onVectorChange(uint32_t id, const VcdParser::TokenView &value) override {
+            log += std::to_string(id) + ' ' + value.toString() + '\n';
+        }
+
+        void onRealChange(uint32_t id, double value) override {
+            log += std::to_string(id) + ' ' + std::to_string(value) + '\n';
+        }
+
+        void onFinish() override {
+            log += "finish\n";
+        }
+    };
+
+    // the last change isn't followed by a newline, so it only ends with finish()
+    const std::string Input = "$date today $end\n"
+                              "$version\n  simulator 1.0\n$end\n"
+                              "$timescale 10 ps $end\n"
+                              "$scope module top $end\n"
+                              "$var wire 1 ! clk $end\n"
+                              "$var wire 12 \"# data $end\n"
+                              "$scope module sub $end\n"
+                              "$var real 64 r value $end\n"
+                              "$upscope $end\n"
+                              "$upscope $end\n"
+                              "$enddefinitions $end\n"
+                              "$comment split $comment $end\n"
+                              "#0\n$dumpvars\n0!\nbx \"#\nr0.25 r\n$end\n"
+                              "#15\n1!\nb101010101010 \"#\n"
+                              "#1234567\nz!\nB1 \"#\nR-1e-3 r\n"
+                              "#1234568\nb0z1 \"#\n1!";
+
+    std::string parseWhole(const std::string &input) {
+        EventLog handler;
+        VcdParser::VcdParser parser(input);
+        parser.setHandler(handler);
+        parser.parse();
+        return handler.log;
+    }
+
+    std::string feed(const std::string &input, const std::vector<size_t> &splits) {
+        EventLog handler;
+        VcdParser::VcdParser parser;
+        parser.setHandler(handler);
+        size_t begin = 0;
+        for (size_t split : splits) {
+            // each chunk is copied, so the parser can't keep pointers into the input
+            std::string chunk = input.substr(begin, split - begin);
+            parser.feed(chunk.data(), chunk.size());
+            begin = split;
+        }
+        std::string chunk = input.substr(begin);
+        parser.feed(chunk.data(), chunk.size());
+        parser.finish();
+        return handler.log;
+    }
+
+    void checkSplits() {
+        std::string expected = parseWhole(Input);
+        CHECK(expected.find("0 1\nfinish\n") != std::string::npos);
+        // every token split in two, including values and the last one
+        for (size_t split = 0; split <= Input.size(); split++) {
+            if (!CHECK(feed(Input, {split}) == expected)) {
+                return;
+            }
+        }
+        static const size_t chunkSizes[] = {1, 2, 3, 5, 16, 100};
+        for (size_t chunkSize : chunkSizes) {
+            std::vector<size_t> splits;
+            for (size_t split = chunkSize; split < Input.size(); split += chunkSize) {
+                splits.push_back(split);
+            }
+            CHECK(feed(Input, splits) == expected);
+        }
+        // empty chunks change nothing
+        CHECK(feed(Input, {0, 0, 40, 40, 40, Input.size()}) == expected);
+    }
+
+    void checkResult() {
+        static const StorageMode modes[] = {StorageMode::PerBit, StorageMode::Packed, StorageMode::Indexed};
+        for (StorageMode mode : modes) {
+            VcdParser::VcdParser whole(Input);
+            whole.setStorageMode(mode);
+            whole.parse();
+            VcdFormat::VcdFile &expected = whole.getResult();
+            if (mode == StorageMode::Indexed) {
+                for (VcdFormat::Variable *variable : expected.variableList) {
+                    expected.load(*variable);
+                }
+            }
+
+            VcdParser::VcdParser fed;
+            fed.setStorageMode(mode);
+            for (size_t i = 0; i < Input.size(); i += 7) {
+                std::string chunk = Input.substr(i, 7);
+                fed.feed(chunk.data(), chunk.size());
+            }
+            fed.finish();
+            // fed input is stored as with StorageMode::Packed instead of Indexed, no load() needed
+            VcdFormat::VcdFile &file = fed.getResult();
+            CHECK(file.timestamps == expected.timestamps);
+            CHECK(file.date == "today" && file.version == "simulator 1.0");
+            CHECK(file.timescale.timeNumber == 10 && file.timescale.timeUnit == VcdFormat::TimeUnit::unit_ps);
+            if (!CHECK(file.variableList.size() == 3)) {
+                continue;
+            }
+            VcdFormat::VcdQuery query(file);
+            VcdFormat::VcdQuery expectedQuery(expected);
+            for (uint64_t time : expected.timestamps) {
+                CHECK(query.snapshotAt(time) == expectedQuery.snapshotAt(time));
+            }
+            CHECK(query.valueAt(*file.findVariable("top.data"), 15) == "101010101010");
+            CHECK(query.valueAt(*file.findVariable("top.data"), 1234568) == "0000000000z1");
+            CHECK(query.valueAt(*file.findVariable("top.clk"), 1234568) == "1");
+        }
+    }
+
+    void parseError(const std::string &input, bool fed, size_t &line, size_t &column) {
+        try {
+            if (fed) {
+                VcdParser::VcdParser parser;
+                for (char ch : input) {
+                    parser.feed(&ch, 1);
+                }
+                parser.finish();
+            } else {
+                VcdParser::VcdParser parser(input);
+                parser.parse();
+            }
+        } catch (const VcdParser::VcdException &exception) {
+            line = exception.line;
+            column = exception.column;
+        }
+    }
+
+    void checkErrors() {
+        static const char *const invalid[] = {"#1234569\nb12 \"#\n", "#1234569\n1?\n", "#x\n",
+                                              "#1234569\nr1 !\n"};
+        for (const char *body : invalid) {
+            std::string input = Input.substr(0, Input.rfind("#1234568")) + body;
+            size_t line = 0;
+            size_t column = 0;
+            parseError(input, false, line, column);
+            size_t fedLine = 0;
+            size_t fedColumn = 0;
+            parseError(input, true, fedLine, fedColumn);
+            CHECK(line != 0 && fedLine == line && fedColumn == column);
+        }
+    }
+}
+
+int main() {
+    checkSplits();
+    checkResult();
+    checkErrors();
+    return VcdTest::checkResult();
+}
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: MIT
+
+// A file followed while it is appended to, polled by hand and on the polling thread with
+// readers running at the same time, against a parse of the finished file.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <follow.h>
+#include <libvcdparser.h>
+#include <query.h>
+
+#include "check.h"
+
+namespace {
+    const char *const Path = "follow_test.vcd";
+
+    const std::string Header = "$timescale 1ns $end\n"
+                               "$scope module top $end\n"
+                               "$var wire 1 ! clk $end\n"
+                               "$var wire 8 \" data $end\n"
+                               "$var real 64 # r $end\n"
+                               "$upscope $end\n"
+                               "$enddefinitions $end\n";
+
+    // splitmix64
+    uint64_t nextRandom(uint64_t &state) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    std::string generate() {
+        uint64_t state = 1;
+        std::string input = Header;
+        for (uint64_t time = 0; time < 20000; time += 10) {
+            input += '#' + std::to_string(time) + '\n';
+            input += "01xz"[nextRandom(state) % 4];
+            input += "!\nb";
+            for (int bit = 0; bit < 8; bit++) {
+                input += "01"[nextRandom(state) % 2];
+            }
+            input += " \"\n";
+            if (nextRandom(state) % 3 == 0) {
+                input += 'r' + std::to_string(nextRandom(state) % 1000) + " #\n";
+            }
+        }
+        return input;
+    }
+
+    /**
+     * Appends to the followed file, flushing every write so the follower sees it.
+     */
+    class Writer {
+        std::FILE *file;
+
+    public:
+        Writer()
+                : file(std::fopen(Path, "wb")) {
+        }
+
+        ~Writer() {
+            std::fclose(file);
+        }
+
+        void write(const std::string &text) {
+            std::fwrite(text.data(), 1, text.size(), file);
+            std::fflush(file);
+        }
+    };
+
+    // completed timestamps, and the values at each of them
+    size_t getCompleted(VcdParser::FileFollower &follower, std::vector<std::vector<std::string>> &snapshots) {
+        size_t count = 0;
+        follower.read([&](const VcdFormat::VcdFile &file, size_t completed) {
+            VcdFormat::VcdQuery query(file);
+            snapshots.clear();
+            for (size_t i = 0; i < completed; i++) {
+                snapshots.push_back(query.snapshotAt(file.timestamps[i]));
+            }
+            count = completed;
+        });
+        return count;
+    }
+
+    void checkPolling() {
+        Writer writer;
+        VcdParser::FileFollower follower(Path);
+        std::vector<std::vector<std::string>> snapshots;
+        uint64_t time = 0;
+        CHECK(!follower.poll() && !follower.getCompletedTime(time));
+
+        // the block of #0 may go on until the next # record
+        writer.write(Header + "#0\n1!\nb1");
+        CHECK(!follower.poll() && getCompleted(follower, snapshots) == 0);
+        // the next # record isn't complete either, it may go on with more digits
+        writer.write("01 \"\n#1");
+        CHECK(!follower.poll() && getCompleted(follower, snapshots) == 0);
+        writer.write("0\n0!\nr2.5 #\n#20\n");
+        CHECK(follower.poll() && getCompleted(follower, snapshots) == 2);
+        CHECK(follower.getCompletedTime(time) && time == 10);
+        CHECK(snapshots[0] == std::vector<std::string>({"1", "00000101", "x"}));
+        CHECK(snapshots[1] == std::vector<std::string>({"0", "00000101", "2.5"}));
+        CHECK(!follower.poll());
+
+        writer.write("bz \"\n");
+        follower.finish();
+        CHECK(getCompleted(follower, snapshots) == 3 && follower.getCompletedTime(time) && time == 20);
+        CHECK(snapshots[2] == std::vector<std::string>({"0", "zzzzzzzz", "2.5"}));
+        CHECK(follower.waitForTime(1000, std::chrono::milliseconds(0)));
+    }
+
+    void checkConcurrent() {
+        std::string input = generate();
+        VcdParser::VcdParser parser(input);
+        parser.parse();
+        VcdFormat::VcdFile &expected = parser.getResult();
+        VcdFormat::VcdQuery expectedQuery(expected);
+
+        Writer writer;
+        VcdParser::FileFollower follower(Path);
+        follower.start(std::chrono::milliseconds(1));
+        std::atomic<bool> done(false);
+        std::atomic<int> mismatches(0);
+        std::atomic<size_t> lastCount(0);
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 3; i++) {
+            readers.emplace_back([&]() {
+                size_t previous = 0;
+                while (!done) {
+                    follower.read([&](const VcdFormat::VcdFile &file, size_t completed) {
+                        // completed timestamps only grow, and their values are final
+                        if (completed < previous || completed > file.timestamps.size()) {
+                            mismatches++;
+                            return;
+                        }
+                        previous = completed;
+                        if (completed == 0) {
+                            return;
+                        }
+                        VcdFormat::VcdQuery query(file);
+                        uint64_t time = file.timestamps[completed - 1];
+                        if (time != expected.timestamps[completed - 1]
+                            || query.snapshotAt(time) != expectedQuery.snapshotAt(time)) {
+                            mismatches++;
+                        }
+                    });
+                    lastCount = previous;
+                    std::this_thread::yield();
+                }
+            });
+        }
+
+        // chunks of random size, split anywhere
+        uint64_t state = 2;
+        for (size_t offset = 0; offset < input.size();) {
+            size_t size = 1 + nextRandom(state) % 4096;
+            writer.write(input.substr(offset, size));
+            offset += size;
+            if (nextRandom(state) % 8 == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        // the last # record is only complete after finish()
+        uint64_t secondLast = expected.timestamps[expected.timestamps.size() - 2];
+        CHECK(follower.waitForTime(secondLast, std::chrono::seconds(10)));
+        CHECK(!follower.waitForTime(secondLast + 1, std::chrono::milliseconds(20)));
+        follower.finish();
+        done = true;
+        for (std::thread &reader : readers) {
+            reader.join();
+        }
+        CHECK(mismatches == 0);
+        CHECK(lastCount > 0);
+
+        std::vector<std::vector<std::string>> snapshots;
+        CHECK(getCompleted(follower, snapshots) == expected.timestamps.size());
+        for (size_t i = 0; i < snapshots.size(); i += 97) {
+            CHECK(snapshots[i] == expectedQuery.snapshotAt(expected.timestamps[i]));
+        }
+    }
+
+    void checkErrors() {
+        CHECK_THROWS(std::runtime_error, VcdParser::FileFollower("follow_test_missing.vcd"));
+        {
+            Writer writer;
+            VcdParser::FileFollower follower(Path);
+            writer.write(Header + "#0\n1!\n#10\nb2 \"\n");
+            CHECK_THROWS(VcdParser::VcdException, follower.poll());
+        }
+        // errors on the polling thread are reported to those waiting for it
+        Writer writer;
+        VcdParser::FileFollower follower(Path);
+        follower.start(std::chrono::milliseconds(1));
+        writer.write(Header + "#0\n1!\n#10\n?!\n");
+        CHECK_THROWS(VcdParser::VcdException, follower.waitForTime(100, std::chrono::seconds(10)));
+        CHECK_THROWS(VcdParser::VcdException, follower.finish());
+    }
+}
+
+int main() {
+    checkPolling();
+    checkConcurrent();
+    checkErrors();
+    std::remove(Path);
+    return VcdTest::checkResult();
+}
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MIT
+
+// Concatenated, padded and truncated gzip files read through GzipSource.
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gzip_source.h>
+#include <libvcdparser.h>
+#include <query.h>
+
+#include <zlib.h>
+
+#include "check.h"
+
+namespace {
+    const char *const Path = "gzip_test.vcd.gz";
+
+    const std::string Header = "$timescale 1ns $end\n"
+                               "$scope module top $end\n"
+                               "$var wire 1 ! clk $end\n"
+                               "$upscope $end\n"
+                               "$enddefinitions $end\n";
+
+    std::string compress(const std::string &text) {
+        z_stream stream{};
+        // 16 writes a gzip header
+        deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        std::vector<unsigned char> output(deflateBound(&stream, text.size()) + 32);
+        stream.next_in = reinterpret_cast<unsigned char *>(const_cast<char *>(text.data()));
+        stream.avail_in = static_cast<uInt>(text.size());
+        stream.next_out = output.data();
+        stream.avail_out = static_cast<uInt>(output.size());
+        deflate(&stream, Z_FINISH);
+        std::string member(reinterpret_cast<char *>(output.data()), stream.total_out);
+        deflateEnd(&stream);
+        return member;
+    }
+
+    void writeFile(const std::string &contents) {
+        std::ofstream out(Path, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    // value of clk at every timestamp
+    std::string parseFile(size_t bufferSize, uint64_t *trailingSize = nullptr) {
+        VcdParser::GzipSource source(Path, bufferSize);
+        VcdParser::VcdParser parser;
+        parser.parseStream(source);
+        if (trailingSize != nullptr) {
+            *trailingSize = source.getTrailingSize();
+        }
+        VcdFormat::VcdFile &file = parser.getResult();
+        VcdFormat::VcdQuery query(file);
+        std::string values;
+        for (uint64_t time : file.timestamps) {
+            values += query.valueAt(*file.variableList[0], time);
+        }
+        return values;
+    }
+
+    void checkMembers() {
+        std::string members = compress(Header + "#0\n0!\n#10\n1!\n") + compress("#20\n0!\n") + compress("#30\nz!\n");
+        static const char *const trailers[] = {"", "\0\0\0\0", "\x1f", "garbage", "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0"};
+        static const size_t trailerSizes[] = {0, 4, 1, 7, 16};
+        for (size_t i = 0; i < sizeof(trailerSizes) / sizeof(trailerSizes[0]); i++) {
+            writeFile(members + std::string(trailers[i], trailerSizes[i]));
+            uint64_t trailingSize = 0;
+            CHECK(parseFile(1024 * 1024, &trailingSize) == "010z");
+            CHECK(trailingSize == trailerSizes[i]);
+            CHECK(parseFile(3) == "010z");
+        }
+        // more padding than one read of the compressed input
+        writeFile(members + std::string(600 * 1024, '\0'));
+        uint64_t trailingSize = 0;
+        CHECK(parseFile(1024, &trailingSize) == "010z");
+        CHECK(trailingSize == 600 * 1024);
+    }
+
+    void checkTruncated() {
+        writeFile("");
+        CHECK_THROWS(std::runtime_error, parseFile(1024));
+        std::string member = compress(Header + "#0\n0!\n#10\n1!\n");
+        writeFile(member.substr(0, member.size() - 4));
+        CHECK_THROWS(std::runtime_error, parseFile(1024));
+        // a second member that is cut off after its magic bytes
+        writeFile(member + "\x1f\x8b");
+        CHECK_THROWS(std::runtime_error, parseFile(1024));
+    }
+}
+
+int main() {
+    checkMembers();
+    checkTruncated();
+    std::remove(Path);
+    return VcdTest::checkResult();
+}
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: MIT
+
+// Order and arguments of the VcdHandler callbacks for a small file.
+
+#include <string>
+
+#include <libvcdparser.h>
+
+#include "check.h"
+
+namespace {
+    /**
+     * Writes every event into one string, in the order the parser calls them.
+     */
+    class EventLog : public VcdParser::VcdHandler {
+    public:
+        std::string log;
+
+        void onHeader(const VcdFormat::Header &header) override {
+            log += "header " + header.date + '|' + header.version + '|' + std::to_string(header.timescale.timeNumber)
+                   + '\n';
+        }
+
+        void onScope(uint32_t id, const VcdParser::ScopeDefinition &scope) override {
+            log += "scope " + std::to_string(id) + ' ' + scope.type + ' ' + scope.name + ' '
+                   + (scope.parent == VcdParser::ScopeDefinition::Root ? "-" : std::to_string(scope.parent)) + '\n';
+        }
+
+        void onVar(uint32_t id, const VcdParser::VarDefinition &var) override {
+            log += "var " + std::to_string(id) + ' ' + std::to_string(var.size) + ' ' + var.identifier + ' '
+                   + var.name + ' ' + getScope(var) + '\n';
+        }
+
+        void onAlias(uint32_t id, const VcdParser::VarDefinition &var) override {
+            log += "alias " + std::to_string(id) + ' ' + var.name + ' ' + getScope(var) + '\n';
+        }
+
+        void onTime(uint64_t time) override {
+            log += '#' + std::to_string(time) + '\n';
+        }
+
+        void onDumpSection(VcdParser::DumpSection section) override {
+            log += "begin " + std::to_string(static_cast<int>(section)) + '\n';
+        }
+
+        void onDumpSectionEnd(VcdParser::DumpSection section) override {
+            log += "end " + std::to_string(static_cast<int>(section)) + '\n';
+        }
+
+        void onScalarChange(uint32_t id, char value) override {
+            log += std::to_string(id) + ' ' + value + '\n';
+        }
+
+        void onVectorChange(uint32_t id, const VcdParser::TokenView &value) override {
+            log += std::to_string(id) + ' ' + value.toString() + '\n';
+        }
+
+        void onRealChange(uint32_t id, double value) override {
+            log += std::to_string(id) + ' ' + std::to_string(value) + '\n';
+        }
+
+        void onFinish() override {
+            log += "finish\n";
+        }
+
+    private:
+        static std::string getScope(const VcdParser::VarDefinition &var) {
+            return var.scope == VcdParser::ScopeDefinition::Root ? "-" : std::to_string(var.scope);
+        }
+    };
+
+    void checkOrder() {
+        // top is entered twice, and clk is declared again in sub with the same identifier code
+        std::string input = "$date today $end\n"
+                            "$version v1 $end\n"
+                            "$timescale 100 ns $end\n"
+                            "$var wire 1 ^ reset $end\n"
+                            "$scope module top $end\n"
+                            "$var wire 1 ! clk $end\n"
+                            "$scope task sub $end\n"
+                            "$var wire 1 ! clk_in $end\n"
+                            "$var wire 8 # data $end\n"
+                            "$upscope $end\n"
+                            "$upscope $end\n"
+                            "$scope module other $end\n"
+                            "$upscope $end\n"
+                            "$scope module top $end\n"
+                            "$var real 64 % r $end\n"
+                            "$upscope $end\n"
+                            "$enddefinitions $end\n"
+                            "#0\n$dumpvars\n1^\n0!\nb1 #\nr1.5 %\n$end\n"
+                            "#5\n0^\n1!\n$dumpoff\nx!\nbx #\n$end\n"
+                            "#7\n$dumpon\n0!\nb10x #\n$end\n"
+                            "$comment 1! $end\n"
+                            "#9\n$dumpall\n0!\nbz #\n$end\nr-2 %\n";
+        std::string expected = "header today|v1|100\n"
+                               "scope 0 module top -\n"
+                               "scope 1 task sub 0\n"
+                               "scope 2 module other -\n"
+                               "var 0 1 ^ reset -\n"
+                               "var 1 1 ! clk 0\n"
+                               "alias 1 clk_in 1\n"
+                               "var 2 8 # data 1\n"
+                               "var 3 64 % r 0\n"
+                               "#0\nbegin 3\n0 1\n1 0\n2 00000001\n3 1.500000\nend 3\n"
+                               "#5\n0 0\n1 1\nbegin 1\n1 x\n2 xxxxxxxx\nend 1\n"
+                               "#7\nbegin 2\n1 0\n2 0000010x\nend 2\n"
+                               "#9\nbegin 0\n1 0\n2 zzzzzzzz\nend 0\n3 -2.000000\n"
+                               "finish\n";
+        EventLog handler;
+        VcdParser::VcdParser parser(input);
+        parser.setHandler(handler);
+        parser.parse();
+        CHECK(handler.log == expected);
+        // the parser doesn't build a file for a handler of its own
+        CHECK(parser.getResult().variableList.empty() && parser.getResult().timestamps.empty());
+    }
+
+    void checkEmpty() {
+        // a file without simulation section still ends with onFinish()
+        std::string input = "$timescale 1 s $end\n$var wire 1 ! a $end\n$enddefinitions $end\n";
+        EventLog handler;
+        VcdParser::VcdParser parser(input);
+        parser.setHandler(handler);
+        parser.parse();
+        CHECK(handler.log == "header ||1\nvar 0 1 ! a -\nfinish\n");
+    }
+}
+
+int main() {
+    checkOrder();
+    checkEmpty();
+    return VcdTest::checkResult();
+}
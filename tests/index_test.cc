@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: MIT
+
+// Variables indexed with StorageMode::Indexed and decoded with VcdFile::load(), against
+// StorageMode::Packed, and the errors load() reports.
+
+#include <cstdint>
+#include <string>
+
+#include <libvcdparser.h>
+#include <query.h>
+
+#include "check.h"
+
+namespace {
+    using VcdFormat::StorageMode;
+
+    // splitmix64
+    uint64_t nextRandom(uint64_t &state) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    const unsigned int Widths[] = {1, 2, 7, 8, 33, 64, 65, 130};
+    const char *const Identifiers[] = {"!", "\"", "#", "$", "%%", "&x", "'", "(("};
+
+    /**
+     * Random changes of variables of every width, with shortened values, upper case 'B',
+     * $dumpvars sections, comments and an alias.
+     */
+    std::string generate() {
+        uint64_t state = 1;
+        std::string input = "$timescale 1ns $end\n$scope module top $end\n";
+        for (size_t v = 0; v < sizeof(Widths) / sizeof(Widths[0]); v++) {
+            input += "$var wire " + std::to_string(Widths[v]) + ' ' + Identifiers[v] + " v" + std::to_string(v)
+                     + " $end\n";
+        }
+        input += "$var real 64 r r $end\n"
+                 "$scope module sub $end\n$var wire 33 %% alias $end\n$upscope $end\n"
+                 "$upscope $end\n$enddefinitions $end\n";
+        static const char values[] = "01xz";
+        uint64_t time = 0;
+        for (int i = 0; i < 3000; i++) {
+            input += '#' + std::to_string(time += 1 + nextRandom(state) % 5) + '\n';
+            bool section = nextRandom(state) % 50 == 0;
+            if (section) {
+                input += "$dumpvars\n";
+            }
+            for (size_t v = 0; v < sizeof(Widths) / sizeof(Widths[0]); v++) {
+                if (!section && nextRandom(state) % 3 != 0) {
+                    continue;
+                }
+                if (Widths[v] == 1) {
+                    input += values[nextRandom(state) % 4];
+                    input += std::string(Identifiers[v]) + '\n';
+                    continue;
+                }
+                size_t length = 1 + nextRandom(state) % Widths[v];
+                input += nextRandom(state) % 8 == 0 ? 'B' : 'b';
+                for (size_t bit = 0; bit < length; bit++) {
+                    input += values[nextRandom(state) % (nextRandom(state) % 4 == 0 ? 4 : 2)];
+                }
+                input += std::string(nextRandom(state) % 2 == 0 ? " " : "\t ") + Identifiers[v] + '\n';
+            }
+            if (nextRandom(state) % 4 == 0) {
+                input += 'r' + std::to_string(nextRandom(state) % 100) + " r\n";
+            }
+            if (section) {
+                input += "$end\n";
+            }
+            if (nextRandom(state) % 20 == 0) {
+                input += "$comment b1 ! $end\n";
+            }
+        }
+        return input;
+    }
+
+    void checkLoad() {
+        std::string input = generate();
+        VcdParser::VcdParser packedParser(input);
+        packedParser.setStorageMode(StorageMode::Packed);
+        packedParser.parse();
+        VcdFormat::VcdFile &packed = packedParser.getResult();
+        VcdFormat::VcdQuery packedQuery(packed);
+
+        VcdParser::VcdParser parser(input);
+        parser.setStorageMode(StorageMode::Indexed);
+        parser.parse();
+        VcdFormat::VcdFile &file = parser.getResult();
+        CHECK(file.timestamps == packed.timestamps);
+        CHECK(file.timeOffsets.size() == file.timestamps.size());
+        for (size_t i = 0; i < file.timeOffsets.size(); i++) {
+            CHECK(input.compare(file.timeOffsets[i], 1, "#") == 0);
+        }
+
+        // only the offsets are stored until load(), reals are stored as they are parsed
+        for (VcdFormat::Variable *variable : file.variableList) {
+            if (variable->aliasOf != nullptr) {
+                continue;
+            }
+            if (variable->isReal()) {
+                CHECK(variable->offsets.count == 0 && !variable->realChanges.empty());
+            } else {
+                CHECK(variable->offsets.count != 0 && variable->changes.count == 0);
+            }
+        }
+        // loading an alias loads the variable it's an alias of, and only that one
+        VcdFormat::Variable &alias = *file.findVariable("top.sub.alias");
+        file.load(alias);
+        CHECK(alias.getCanonical().offsets.count == 0 && alias.getCanonical().changes.count != 0);
+        CHECK(file.findVariable("top.v0")->offsets.count != 0);
+
+        for (VcdFormat::Variable *variable : file.variableList) {
+            file.load(*variable);
+        }
+        // loading again changes nothing
+        file.load(*file.findVariable("top.v6"));
+        VcdFormat::VcdQuery query(file);
+        for (size_t i = 0; i < file.variableList.size(); i++) {
+            const VcdFormat::Variable &variable = *file.variableList[i];
+            const VcdFormat::Variable &expected = *packed.variableList[i];
+            if (!variable.isReal() && !CHECK(variable.getCanonical().changes.count
+                                             == expected.getCanonical().changes.count)) {
+                continue;
+            }
+            for (size_t t = 0; t < file.timestamps.size(); t += 7) {
+                uint64_t time = file.timestamps[t];
+                if (!CHECK(query.valueAt(variable, time) == packedQuery.valueAt(expected, time))) {
+                    break;
+                }
+            }
+        }
+    }
+
+    void getError(const std::string &input, StorageMode mode, std::string &message, size_t &line, size_t &column) {
+        try {
+            VcdParser::VcdParser parser(input);
+            parser.setStorageMode(mode);
+            parser.parse();
+            VcdFormat::VcdFile &file = parser.getResult();
+            if (mode == StorageMode::Indexed) {
+                // the valid variable loads even though another one doesn't
+                file.load(*file.findVariable("a"));
+                CHECK(file.findVariable("a")->changes.count == 2);
+                for (VcdFormat::Variable *variable : file.variableList) {
+                    file.load(*variable);
+                }
+            }
+        } catch (const VcdParser::VcdException &exception) {
+            message = exception.msg;
+            line = exception.line;
+            column = exception.column;
+        }
+    }
+
+    void checkErrors() {
+        std::string header = "$var wire 1 ! a $end\n$var wire 4 \" b $end\n$var wire 1 # c $end\n"
+                             "$enddefinitions $end\n#0\n0!\n";
+        // values are only checked when they are loaded
+        static const char *const invalid[] = {"#5\n  b1?1 \"\n1!\n", "#5\nb11111 \"\n1!\n", "#5\n1!\n b10\t\tb2 \"\n",
+                                              "#5\n1!\n  ?#\n", "#5\n1!\nb0 \"\n#6\nB1x-w\n\"\n"};
+        for (const char *body : invalid) {
+            std::string input = header + body;
+            std::string message;
+            size_t line = 0;
+            size_t column = 0;
+            getError(input, StorageMode::Packed, message, line, column);
+            std::string loadMessage;
+            size_t loadLine = 0;
+            size_t loadColumn = 0;
+            getError(input, StorageMode::Indexed, loadMessage, loadLine, loadColumn);
+            CHECK(!message.empty() && loadMessage == message && loadLine == line && loadColumn == column);
+        }
+    }
+}
+
+int main() {
+    checkLoad();
+    checkErrors();
+    return VcdTest::checkResult();
+}
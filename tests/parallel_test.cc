@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: MIT
+
+// Parsing with several threads against parsing with one, on inputs whose comments, dump
+// sections and errors fall on the chunk boundaries.
+
+#include <cstdint>
+#include <string>
+
+#include <libvcdparser.h>
+
+#include "check.h"
+
+namespace {
+    /**
+     * Writes every event into one string, so two parses can be compared as a whole.
+     */
+    class EventLog : public VcdParser::VcdHandler {
+    public:
+        std::string log;
+
+        void onTime(uint64_t time) override {
+            log += '#' + std::to_string(time) + '\n';
+        }
+
+        void onDumpSection(VcdParser::DumpSection section) override {
+            log += "begin " + std::to_string(static_cast<int>(section)) + '\n';
+        }
+
+        void onDumpSectionEnd(VcdParser::DumpSection section) override {
+            log += "end " + std::to_string(static_cast<int>(section)) + '\n';
+        }
+
+        void onScalarChange(uint32_t id, char value) override {
+            log += std::to_string(id) + ' ' + value + '\n';
+        }
+
+        void onVectorChange(uint32_t id, const VcdParser::TokenView &value) override {
+            log += std::to_string(id) + ' ' + value.toString() + '\n';
+        }
+
+        void onRealChange(uint32_t id, double value) override {
+            log += std::to_string(id) + ' ' + std::to_string(value) + '\n';
+        }
+    };
+
+    // splitmix64
+    uint64_t nextRandom(uint64_t &state) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    const std::string Header = "$timescale 1ns $end\n"
+                               "$scope module top $end\n"
+                               "$var wire 1 ! clk $end\n"
+                               "$var wire 16 \" data $end\n"
+                               "$var real 64 # r $end\n"
+                               "$upscope $end\n"
+                               "$enddefinitions $end\n";
+
+    /**
+     * About 4 MiB of changes in blocks of 100 KiB, most of each taken by a comment or a
+     * $dumpall section, so that the 1 MiB chunks of the parallel parse start inside them.
+     * The comments hold lines that look like # records and value changes.
+     */
+    std::string generate(bool dumpSections) {
+        uint64_t state = 1;
+        std::string input = Header;
+        uint64_t time = 0;
+        while (input.size() < 4 * 1024 * 1024) {
+            size_t blockEnd = input.size() + 10 * 1024;
+            while (input.size() < blockEnd) {
+                input += '#' + std::to_string(time += 1 + nextRandom(state) % 5) + '\n';
+                input += "01xz"[nextRandom(state) % 4];
+                input += "!\nb";
+                input += std::to_string(nextRandom(state) % 2) + "10x \"\n";
+            }
+            input += '#' + std::to_string(++time) + '\n';
+            blockEnd = input.size() + 90 * 1024;
+            input += dumpSections ? "$dumpall\n" : "$comment\n";
+            while (input.size() < blockEnd) {
+                if (dumpSections) {
+                    input += "1!\nb1z \"\nr0.5 #\n";
+                } else {
+                    input += "#9 note\nb101 \"\n";
+                }
+            }
+            input += "$end\n";
+        }
+        return input;
+    }
+
+    std::string parse(const std::string &input, unsigned int threads, std::string &error) {
+        EventLog handler;
+        VcdParser::VcdParser parser(input);
+        parser.setHandler(handler);
+        parser.setThreadCount(threads);
+        try {
+            parser.parse();
+        } catch (const VcdParser::VcdException &exception) {
+            error = exception.msg + " at " + std::to_string(exception.line) + ':' + std::to_string(exception.column);
+        }
+        return handler.log;
+    }
+
+    void checkSame(const std::string &input) {
+        std::string sequentialError;
+        std::string sequential = parse(input, 1, sequentialError);
+        static const unsigned int threadCounts[] = {2, 4, 7};
+        for (unsigned int threads : threadCounts) {
+            std::string error;
+            std::string parallel = parse(input, threads, error);
+            CHECK(error == sequentialError);
+            if (sequentialError.empty()) {
+                CHECK(parallel == sequential);
+            }
+        }
+    }
+}
+
+int main() {
+    std::string comments = generate(false);
+    checkSame(comments);
+    checkSame(generate(true));
+    // errors are reported at the same position, also behind a comment crossing a chunk start
+    std::string invalid = comments;
+    invalid.insert(invalid.rfind("$end") + 5, "#99999999\nb2 \"\n");
+    checkSame(invalid);
+    invalid = comments;
+    invalid.insert(invalid.find("#9 note", 1024 * 1024 + 512 * 1024), "$end\nbad\n");
+    checkSame(invalid);
+    return VcdTest::checkResult();
+}
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MIT
+
+// Value changes that don't match the type of their variable, and queries of real variables.
+
+#include <string>
+
+#include <activity.h>
+#include <libvcdparser.h>
+#include <query.h>
+
+#include "check.h"
+
+namespace {
+    using VcdFormat::StorageMode;
+
+    const StorageMode Modes[] = {StorageMode::PerBit, StorageMode::Packed, StorageMode::Indexed};
+
+    const std::string RealHeader = "$timescale 1ns $end\n"
+                                   "$scope module top $end\n"
+                                   "$var real 64 ! r $end\n"
+                                   "$var wire 1 \" w $end\n"
+                                   "$upscope $end\n"
+                                   "$enddefinitions $end\n";
+
+    void parse(const std::string &input, StorageMode mode) {
+        VcdParser::VcdParser parser(input);
+        parser.setStorageMode(mode);
+        parser.parse();
+    }
+
+    void checkChangesOfReal() {
+        for (StorageMode mode : Modes) {
+            CHECK_THROWS(VcdParser::VcdException, parse(RealHeader + "#0\n1!\n", mode));
+            CHECK_THROWS(VcdParser::VcdException, parse(RealHeader + "#0\nb1 !\n", mode));
+            CHECK_THROWS(VcdParser::VcdException, parse(RealHeader + "#0\nbx !\n", mode));
+            CHECK_THROWS(VcdParser::VcdException, parse(RealHeader + "#0\nr1 \"\n", mode));
+            parse(RealHeader + "#0\nr1 !\n1\"\n", mode);
+        }
+    }
+
+    void checkRealValues() {
+        std::string input = RealHeader + "#0\n1\"\n#5\nr1.5 !\n#10\nr-0.1 !\n#20\nr3e100 !\n";
+        for (StorageMode mode : Modes) {
+            VcdParser::VcdParser parser(input);
+            parser.setStorageMode(mode);
+            parser.parse();
+            VcdFormat::VcdFile &file = parser.getResult();
+            const VcdFormat::Variable *real = file.findVariable("top.r");
+            if (!CHECK(real != nullptr)) {
+                return;
+            }
+            VcdFormat::VcdQuery query(file);
+            CHECK(query.valueAt(*real, 0) == "x");
+            CHECK(query.valueAt(*real, 5) == "1.5");
+            CHECK(query.valueAt(*real, 9) == "1.5");
+            CHECK(std::stod(query.valueAt(*real, 10)) == -0.1);
+            CHECK(std::stod(query.valueAt(*real, 100)) == 3e100);
+            CHECK(query.snapshotAt(7)[0] == "1.5");
+            uint64_t time;
+            CHECK(!VcdFormat::findNextEdge(query, *real, 0, VcdFormat::Edge::Any, 0, time));
+            CHECK(real->isReal() && !file.findVariable("top.w")->isReal());
+        }
+        // a real variable without changes, and a real alias of it
+        std::string unchanged = "$scope module top $end\n"
+                                "$var real 64 ! r $end\n"
+                                "$var wire 1 \" w $end\n"
+                                "$upscope $end\n"
+                                "$var realtime 64 ! t $end\n"
+                                "$enddefinitions $end\n"
+                                "#0\n1\"\n#5\n0\"\n";
+        for (StorageMode mode : Modes) {
+            VcdParser::VcdParser parser(unchanged);
+            parser.setStorageMode(mode);
+            parser.parse();
+            VcdFormat::VcdFile &file = parser.getResult();
+            if (mode == StorageMode::Indexed) {
+                file.load(*file.findVariable("top.w"));
+            }
+            VcdFormat::VcdQuery query(file);
+            CHECK(query.valueAt(*file.findVariable("top.r"), 5) == "x");
+            CHECK(query.valueAt(*file.findVariable("t"), 5) == "x");
+            CHECK(query.valueAt(*file.findVariable("top.w"), 5) == "0");
+            CHECK(VcdFormat::measureActivity(file, *file.findVariable("top.r")).bits.empty());
+        }
+    }
+}
+
+int main() {
+    checkChangesOfReal();
+    checkRealValues();
+    return VcdTest::checkResult();
+}
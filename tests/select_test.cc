@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: MIT
+
+// Variables selected by name, glob and identifier code, against a parse of all variables.
+
+#include <string>
+#include <vector>
+
+#include <libvcdparser.h>
+#include <query.h>
+
+#include "check.h"
+
+namespace {
+    using VcdFormat::StorageMode;
+
+    const StorageMode Modes[] = {StorageMode::PerBit, StorageMode::Packed, StorageMode::Indexed};
+
+    const std::string Input = "$timescale 1ns $end\n"
+                              "$var wire 1 % reset $end\n"
+                              "$scope module top $end\n"
+                              "$var wire 1 ! clk $end\n"
+                              "$var wire 8 \" data $end\n"
+                              "$scope module sub $end\n"
+                              "$var wire 1 # en $end\n"
+                              "$var real 64 $ r $end\n"
+                              "$var wire 8 \" data_in $end\n"
+                              "$upscope $end\n"
+                              "$upscope $end\n"
+                              "$enddefinitions $end\n"
+                              "#0\n$dumpvars\n1%\n0!\nb0 \"\n0#\nr0 $\n$end\n"
+                              "#10\n0%\n1!\nb1010 \"\n"
+                              "#20\n0!\n1#\nr2.5 $\n"
+                              "#30\n1!\nbx1 \"\n0#\n";
+
+    /**
+     * Receives the selected variables and the ids of the changes reported for them.
+     */
+    class SelectionLog : public VcdParser::VcdHandler {
+    public:
+        std::string log;
+
+        void onVar(uint32_t id, const VcdParser::VarDefinition &var) override {
+            log += "var " + std::to_string(id) + ' ' + var.name + '\n';
+        }
+
+        void onAlias(uint32_t id, const VcdParser::VarDefinition &var) override {
+            log += "alias " + std::to_string(id) + ' ' + var.name + '\n';
+        }
+
+        void onScalarChange(uint32_t id, char /*value*/) override {
+            log += std::to_string(id);
+        }
+
+        void onVectorChange(uint32_t id, const VcdParser::TokenView &/*value*/) override {
+            log += std::to_string(id);
+        }
+
+        void onRealChange(uint32_t id, double /*value*/) override {
+            log += std::to_string(id);
+        }
+    };
+
+    struct Selection {
+        std::vector<std::string> names;
+        std::vector<std::string> identifiers;
+    };
+
+    void select(VcdParser::VcdParser &parser, const Selection &selection) {
+        for (const std::string &name : selection.names) {
+            parser.selectByName(name);
+        }
+        for (const std::string &identifier : selection.identifiers) {
+            parser.selectByIdentifier(identifier);
+        }
+    }
+
+    std::string getLog(const std::string &input, const Selection &selection) {
+        SelectionLog handler;
+        VcdParser::VcdParser parser(input);
+        parser.setHandler(handler);
+        select(parser, selection);
+        parser.parse();
+        return handler.log;
+    }
+
+    void checkHandler() {
+        // a name selects that variable only, not the others declared with its identifier code
+        CHECK(getLog(Input, {{"top.data"}, {}}) == "var 0 data\n000");
+        // '*' also matches the '.' between scopes
+        CHECK(getLog(Input, {{"*.clk"}, {}}) == "var 0 clk\n0000");
+        CHECK(getLog(Input, {{"top.s?b.*"}, {}}) == "var 0 en\nvar 1 r\nvar 2 data_in\n20120120");
+        CHECK(getLog(Input, {{"top.clk", "reset"}, {"$"}}) == "var 0 reset\nvar 1 clk\nvar 2 r\n01201121");
+        // an identifier code selects all variables declared with it, in declaration order
+        CHECK(getLog(Input, {{}, {"#", "\""}}) == "var 0 data\nvar 1 en\nalias 0 data_in\n010101");
+        CHECK(getLog(Input, {{"nothing", "top"}, {"?"}}) == "");
+    }
+
+    void checkFile() {
+        static const Selection selections[] = {{{"top.data"}, {}}, {{"top.s?b.*", "reset"}, {}}, {{}, {"!", "$"}}};
+        static const char *const expectedPaths[][4] = {{"top.data"},
+                                                       {"reset", "top.sub.en", "top.sub.r", "top.sub.data_in"},
+                                                       {"top.clk", "top.sub.r"}};
+        static const char *const allPaths[] = {"reset", "top.clk", "top.data", "top.sub.en", "top.sub.r",
+                                               "top.sub.data_in"};
+        for (StorageMode mode : Modes) {
+            VcdParser::VcdParser full(Input);
+            full.setStorageMode(mode);
+            full.parse();
+            VcdFormat::VcdFile &fullFile = full.getResult();
+            for (size_t i = 0; i < sizeof(selections) / sizeof(selections[0]); i++) {
+                VcdParser::VcdParser parser(Input);
+                parser.setStorageMode(mode);
+                select(parser, selections[i]);
+                parser.parse();
+                VcdFormat::VcdFile &file = parser.getResult();
+                if (mode == StorageMode::Indexed) {
+                    for (VcdFormat::Variable *variable : file.variableList) {
+                        file.load(*variable);
+                    }
+                    for (VcdFormat::Variable *variable : fullFile.variableList) {
+                        fullFile.load(*variable);
+                    }
+                }
+                CHECK(file.timestamps == fullFile.timestamps);
+                VcdFormat::VcdQuery query(file);
+                VcdFormat::VcdQuery fullQuery(fullFile);
+                size_t selected = 0;
+                for (const char *path : allPaths) {
+                    const VcdFormat::Variable *variable = file.findVariable(path);
+                    bool expected = false;
+                    for (const char *expectedPath : expectedPaths[i]) {
+                        expected = expected || (expectedPath != nullptr && std::string(expectedPath) == path);
+                    }
+                    if (!CHECK((variable != nullptr) == expected) || variable == nullptr) {
+                        continue;
+                    }
+                    selected++;
+                    for (uint64_t time : fullFile.timestamps) {
+                        CHECK(query.valueAt(*variable, time) == fullQuery.valueAt(*fullFile.findVariable(path), time));
+                    }
+                }
+                CHECK(file.variableList.size() == selected);
+            }
+        }
+    }
+
+    void checkSkipped() {
+        // changes of unselected identifier codes aren't validated
+        std::string input = Input + "#40\nb12 #\nr1 #\nbz %\nb1 $\n1!\n";
+        Selection selection{{"top.clk"}, {}};
+        CHECK(getLog(input, selection) == "var 0 clk\n00000");
+        // an unselected identifier isn't an undefined one
+        CHECK_THROWS(VcdParser::VcdException, getLog(input + "1?\n", selection));
+        CHECK_THROWS(VcdParser::VcdException, getLog(input + "b1 ?\n", selection));
+        // nor does it hide errors of the selected ones
+        CHECK_THROWS(VcdParser::VcdException, getLog(input + "b12 !\n", selection));
+    }
+}
+
+int main() {
+    checkHandler();
+    checkFile();
+    checkSkipped();
+    return VcdTest::checkResult();
+}
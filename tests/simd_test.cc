@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: MIT
+
+// Value validation, packing and binary conversion of every SIMD level against the scalar
+// definitions.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <simd.h>
+
+#include "check.h"
+
+namespace {
+    using VcdParser::Simd::Level;
+
+    const Level Levels[] = {Level::Scalar, Level::SSE2, Level::AVX2};
+    const char ValueChars[] = "01xXzZuU-";
+
+    // splitmix64
+    uint64_t nextRandom(uint64_t &state) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    std::string randomValue(uint64_t &state, size_t length) {
+        std::string value(length, '0');
+        for (char &ch : value) {
+            ch = ValueChars[nextRandom(state) % 9];
+        }
+        return value;
+    }
+
+    // lengths around the block sizes and the tails after whole blocks
+    std::vector<size_t> getLengths() {
+        std::vector<size_t> lengths;
+        for (size_t length = 0; length <= 70; length++) {
+            lengths.push_back(length);
+        }
+        static const size_t more[] = {95, 96, 97, 127, 128, 129, 255, 256, 257, 511, 512, 513, 1000};
+        lengths.insert(lengths.end(), more, more + sizeof(more) / sizeof(more[0]));
+        return lengths;
+    }
+
+    void checkFindInvalidValue() {
+        // bytes that only differ from value characters in the lower case bit or in one bit
+        static const char invalid[] = {'a', '2', '/', 'y', 'Y', 'w', '{', '.', ',', ' ', '\0', '\r', '\x10',
+                                       '\x0d', '\x80', '\xff', 'b', 'r', 'X' + 1, 'Z' - 1, 'U' ^ 0x40};
+        uint64_t state = 1;
+        for (size_t length : getLengths()) {
+            std::string value = randomValue(state, length);
+            for (Level level : Levels) {
+                VcdParser::Simd::FindInvalidValueFunction find = VcdParser::Simd::getFindInvalidValue(level);
+                CHECK(find(value.data(), value.data() + length) == value.data() + length);
+            }
+            for (size_t position = 0; position < length; position++) {
+                std::string broken = value;
+                broken[position] = invalid[nextRandom(state) % sizeof(invalid)];
+                // a second invalid character after the first must not be reported
+                if (position + 1 < length && nextRandom(state) % 2 == 0) {
+                    broken[length - 1] = invalid[nextRandom(state) % sizeof(invalid)];
+                }
+                for (Level level : Levels) {
+                    VcdParser::Simd::FindInvalidValueFunction find = VcdParser::Simd::getFindInvalidValue(level);
+                    if (!CHECK(find(broken.data(), broken.data() + length) == broken.data() + position)) {
+                        return;
+                    }
+                }
+            }
+        }
+        // every byte value at the start of a block and in a tail
+        for (int byte = 0; byte < 256; byte++) {
+            std::string value = randomValue(state, 40);
+            value[0] = value[35] = static_cast<char>(byte);
+            size_t expected = VcdParser::Simd::isValueChar(static_cast<char>(byte)) ? value.size() : 0;
+            std::string tail = value.substr(20);
+            size_t expectedTail = VcdParser::Simd::isValueChar(static_cast<char>(byte)) ? tail.size() : 15;
+            for (Level level : Levels) {
+                VcdParser::Simd::FindInvalidValueFunction find = VcdParser::Simd::getFindInvalidValue(level);
+                CHECK(find(value.data(), value.data() + value.size()) - value.data() == static_cast<ptrdiff_t>(expected));
+                CHECK(find(tail.data(), tail.data() + tail.size()) - tail.data()
+                      == static_cast<ptrdiff_t>(expectedTail));
+            }
+        }
+    }
+
+    void checkPackValue() {
+        const uint8_t Guard = 0xa5;
+        uint64_t state = 2;
+        for (size_t length : getLengths()) {
+            for (int i = 0; i < 8; i++) {
+                std::string value = randomValue(state, length);
+                size_t stride = (length + 3) / 4;
+                std::vector<uint8_t> expected(stride + 8, 0);
+                for (size_t bit = 0; bit < length; bit++) {
+                    expected[bit / 4] |= VcdFormat::toLogicState(value[length - 1 - bit]) << (bit % 4 * 2);
+                }
+                std::fill(expected.begin() + stride, expected.end(), Guard);
+                for (Level level : Levels) {
+                    std::vector<uint8_t> states(stride + 8, 0);
+                    std::fill(states.begin() + stride, states.end(), Guard);
+                    VcdParser::Simd::getPackValue(level)(states.data(), value.data(), length);
+                    if (!CHECK(states == expected)) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    void checkToBinary() {
+        uint64_t state = 3;
+        for (size_t length : getLengths()) {
+            std::string value(length, '0');
+            for (char &ch : value) {
+                ch = static_cast<char>('0' + nextRandom(state) % 2);
+            }
+            size_t wordCount = (length + 63) / 64;
+            std::vector<uint64_t> expected(wordCount + 2, 0);
+            for (size_t bit = 0; bit < length; bit++) {
+                expected[bit / 64] |= static_cast<uint64_t>(value[length - 1 - bit] - '0') << (bit % 64);
+            }
+            expected[wordCount] = expected[wordCount + 1] = 0xa5a5a5a5a5a5a5a5;
+            for (Level level : Levels) {
+                VcdParser::Simd::ToBinaryFunction toBinary = VcdParser::Simd::getToBinary(level);
+                std::vector<uint64_t> words(wordCount + 2, 0x5a5a5a5a5a5a5a5a);
+                words[wordCount] = words[wordCount + 1] = 0xa5a5a5a5a5a5a5a5;
+                if (!CHECK(toBinary(words.data(), value.data(), length) && words == expected)) {
+                    return;
+                }
+                // any other value character, at every position
+                for (size_t position = 0; position < length; position++) {
+                    std::string other = value;
+                    other[position] = ValueChars[2 + nextRandom(state) % 7];
+                    if (!CHECK(!toBinary(words.data(), other.data(), length))) {
+                        return;
+                    }
+                    other[position] = static_cast<char>(nextRandom(state) % 256);
+                    bool binary = other[position] == '0' || other[position] == '1';
+                    if (!CHECK(toBinary(words.data(), other.data(), length) == binary)) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    checkFindInvalidValue();
+    checkPackValue();
+    checkToBinary();
+    return VcdTest::checkResult();
+}
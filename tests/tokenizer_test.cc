@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: MIT
+
+// Token streams and positions of every SIMD level, whole and fed in chunks, against a
+// byte by byte reference.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tokenizer.h>
+
+#include "check.h"
+
+namespace {
+    using VcdParser::Simd::Level;
+
+    struct Token {
+        std::string text;
+        size_t offset;
+        size_t line;
+        size_t column;
+
+        bool operator==(const Token &other) const {
+            return text == other.text && offset == other.offset && line == other.line && column == other.column;
+        }
+    };
+
+    const Level Levels[] = {Level::Scalar, Level::SSE2, Level::AVX2};
+
+    std::vector<Token> tokenizeReference(const std::string &input) {
+        std::vector<Token> tokens;
+        size_t line = 1;
+        size_t column = 0;
+        Token token;
+        bool inToken = false;
+        for (size_t i = 0; i < input.size(); i++) {
+            bool delimiter = VcdParser::Simd::isDelimiter(input[i]);
+            if (!delimiter && !inToken) {
+                token = {std::string(), i, line, column};
+                inToken = true;
+            }
+            if (!delimiter) {
+                token.text += input[i];
+            } else if (inToken) {
+                tokens.push_back(token);
+                inToken = false;
+            }
+            if (input[i] == '\n') {
+                line++;
+                column = 0;
+            } else {
+                column++;
+            }
+        }
+        if (inToken) {
+            tokens.push_back(token);
+        }
+        return tokens;
+    }
+
+    void readTokens(VcdParser::Tokenizer &tokenizer, std::vector<Token> &tokens) {
+        for (VcdParser::TokenView token = tokenizer.getNextTokenView(); !token.empty();
+             token = tokenizer.getNextTokenView()) {
+            tokens.push_back({token.toString(), tokenizer.getLastOffset(),
+                              tokenizer.getLastLine(), tokenizer.getLastColumn()});
+        }
+    }
+
+    std::vector<Token> tokenizeWhole(const std::string &input, Level level) {
+        VcdParser::Tokenizer tokenizer(input.data(), input.size());
+        tokenizer.setSimdLevel(level);
+        std::vector<Token> tokens;
+        readTokens(tokenizer, tokens);
+        return tokens;
+    }
+
+    std::vector<Token> tokenizeFed(const std::string &input, Level level, size_t chunkSize) {
+        VcdParser::Tokenizer tokenizer;
+        tokenizer.setSimdLevel(level);
+        std::vector<Token> tokens;
+        // each chunk is a copy that dies after it was consumed, as a reader's buffer would
+        for (size_t offset = 0; offset < input.size(); offset += chunkSize) {
+            std::string chunk = input.substr(offset, chunkSize);
+            tokenizer.feed(chunk.data(), chunk.size());
+            readTokens(tokenizer, tokens);
+        }
+        tokenizer.finish();
+        readTokens(tokenizer, tokens);
+        return tokens;
+    }
+
+    void checkInput(const std::string &input) {
+        std::vector<Token> expected = tokenizeReference(input);
+        static const size_t chunkSizes[] = {1, 2, 3, 7, 15, 16, 17, 31, 32, 33, 64, 4096};
+        for (Level level : Levels) {
+            if (!CHECK(tokenizeWhole(input, level) == expected)) {
+                return;
+            }
+            for (size_t chunkSize : chunkSizes) {
+                if (!CHECK(tokenizeFed(input, level, chunkSize) == expected)) {
+                    return;
+                }
+            }
+        }
+    }
+
+    // splitmix64
+    uint64_t nextRandom(uint64_t &state) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    // tokens of every length that matters to the 16 and 32 byte kernels, at every alignment
+    void checkBoundaries() {
+        static const size_t lengths[] = {1, 2, 15, 16, 17, 31, 32, 33, 47, 48, 49, 63, 64, 65, 100};
+        static const char delimiters[] = {' ', '\n', '\r', '\t', '\0'};
+        for (size_t offset = 0; offset < 40; offset++) {
+            for (size_t length : lengths) {
+                for (char delimiter : delimiters) {
+                    std::string input(offset, offset % 3 == 0 ? '\n' : ' ');
+                    input.append(length, 'a');
+                    input += delimiter;
+                    input += "b1 #";
+                    checkInput(input);
+                    // without a delimiter at the end
+                    checkInput(input.substr(0, offset + length));
+                }
+            }
+        }
+    }
+
+    // malformed input: any byte, including NUL and bytes above 127, and runs of delimiters
+    void checkRandom() {
+        uint64_t state = 1;
+        static const char delimiters[] = {' ', '\n', '\r', '\t', '\0'};
+        for (int i = 0; i < 300; i++) {
+            std::string input;
+            size_t tokens = nextRandom(state) % 40;
+            for (size_t j = 0; j < tokens; j++) {
+                size_t length = nextRandom(state) % 80;
+                for (size_t k = 0; k < length; k++) {
+                    char ch = static_cast<char>(nextRandom(state) % 256);
+                    input += VcdParser::Simd::isDelimiter(ch) ? 'x' : ch;
+                }
+                size_t spaces = 1 + nextRandom(state) % 4;
+                for (size_t k = 0; k < spaces; k++) {
+                    input += delimiters[nextRandom(state) % 5];
+                }
+            }
+            checkInput(input);
+        }
+    }
+}
+
+int main() {
+    checkInput("");
+    checkInput(" \n\r\t");
+    checkInput("$date\n  today\n$end\n#10\nb1010 !\n1\"\nr1.5 #\n");
+    checkBoundaries();
+    checkRandom();
+    return VcdTest::checkResult();
+}
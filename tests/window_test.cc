@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: MIT
+
+// Values at the start of time windows against a parse of the whole input.
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <libvcdparser.h>
+#include <query.h>
+
+#include "check.h"
+
+namespace {
+    const std::string Header = "$timescale 1ns $end\n"
+                               "$scope module top $end\n"
+                               "$var wire 1 ! clk $end\n"
+                               "$var wire 4 \" data $end\n"
+                               "$var real 64 # r $end\n"
+                               "$upscope $end\n"
+                               "$enddefinitions $end\n";
+
+    std::vector<std::string> getSnapshot(const std::string &input, uint64_t time, bool windowed) {
+        VcdParser::VcdParser parser(input);
+        parser.setStorageMode(VcdFormat::StorageMode::Packed);
+        if (windowed) {
+            parser.setTimeWindow(time, time + 5);
+        }
+        parser.parse();
+        VcdFormat::VcdQuery query(parser.getResult());
+        return query.snapshotAt(time);
+    }
+
+    void checkWindows(const std::string &input, uint64_t last) {
+        for (uint64_t time = 0; time <= last; time += 5) {
+            if (!CHECK(getSnapshot(input, time, true) == getSnapshot(input, time, false))) {
+                return;
+            }
+        }
+    }
+
+    void checkCheckpoints() {
+        // sections only in the comments don't hold the values
+        std::string input = Header + "#0\n$dumpvars\n0!\nb0000 \"\nr1 #\n$end\n"
+                                     "#10\n1!\n$comment the $dumpvars section is at #0 $end\n"
+                                     "#20\n0!\nb1x \"\n$comment\n$dumpall\n$end\n"
+                                     "#30\n1!\n$dumpall 1! b1x \" r2 # $end\n"
+                                     "#40\n0!\n$comment $dumpvars $end\n"
+                                     "#50\nb0 \"\n";
+        checkWindows(input, 60);
+        // a checkpoint after the last # line
+        checkWindows(Header + "#0\n1!\n#10\n$dumpvars 0! b1 \" $end\n", 20);
+        // no checkpoint at all
+        checkWindows(Header + "#0\n1!\n#10\nb1z \"\n#20\nr0.5 #\n", 30);
+    }
+
+    void checkCommentedTimes() {
+        // # lines in comments are neither the start of a window nor a checkpoint
+        std::string input = Header + "#0\n$dumpvars 0! b0 \" r0 # $end\n"
+                                     "#10\n1!\n$comment\n#99 note\n#12 note\n$end\n"
+                                     "#20\n0!\nb11 \"\n$comment\n#25\n$end\n"
+                                     "#30\n$comment\n#31\n$dumpall\n$end\n$dumpall 1! b1x \" r2 # $end\n"
+                                     "#40\n$comment\n#47 note\n$end\n0!\n#44\nr3 #\n"
+                                     "#50\nb0 \"\n";
+        checkWindows(input, 60);
+        // the changes after the comment belong to #40 and #44, before the window
+        VcdParser::VcdParser parser(input);
+        parser.setStorageMode(VcdFormat::StorageMode::Packed);
+        parser.setTimeWindow(45, 50);
+        parser.parse();
+        CHECK(parser.getResult().timestamps == std::vector<uint64_t>({45, 50}));
+        // the # line before the checkpoint is the one before the comment
+        checkWindows(Header + "#0\n1!\n#30\n$comment\n#31\n$end\n$dumpall 0! b1x \" r2 # $end\n#40\n1!\n", 50);
+    }
+
+    void checkBisection() {
+        // large enough for the search to bisect, landing in comments whose # lines are later
+        // than any time record
+        std::string large = Header;
+        for (uint64_t time = 0; time < 20000; time += 10) {
+            large += '#' + std::to_string(time) + "\n" + "01"[time / 10 % 2] + "!\n$comment\n";
+            for (int i = 0; i < 40; i++) {
+                large += "#99999 " + std::to_string(time) + "\n";
+            }
+            large += "$end\nb" + std::to_string(time / 20 % 2) + "1 \"\n";
+        }
+        static const uint64_t times[] = {5, 4200, 9995, 15000, 19985};
+        for (uint64_t time : times) {
+            CHECK(getSnapshot(large, time, true) == getSnapshot(large, time, false));
+            VcdParser::VcdParser parser(large);
+            parser.setStorageMode(VcdFormat::StorageMode::Packed);
+            parser.setTimeWindow(time, time + 5);
+            parser.parse();
+            // the window starts at its first time record, with the values before it
+            uint64_t next = (time + 9) / 10 * 10;
+            CHECK(parser.getResult().timestamps
+                  == (next <= time + 5 && next != time ? std::vector<uint64_t>({time, next})
+                                                       : std::vector<uint64_t>({time})));
+        }
+    }
+
+    void checkInvalid() {
+        // 2^64 is reported by the parser, whether the window starts before or after it
+        std::string input = Header + "#0\n1!\n#10\n0!\n#18446744073709551616\n1!\n#30\n0!\n";
+        VcdParser::VcdParser parser(input);
+        parser.setTimeWindow(20, 40);
+        CHECK_THROWS(VcdParser::VcdException, parser.parse());
+
+        VcdParser::VcdParser reversed(input);
+        CHECK_THROWS(std::invalid_argument, reversed.setTimeWindow(20, 10));
+    }
+}
+
+int main() {
+    checkCheckpoints();
+    checkCommentedTimes();
+    checkBisection();
+    checkInvalid();
+    return VcdTest::checkResult();
+}
@@ -1,10 +1,18 @@
 // SPDX-License-Identifier: MIT
 
 #include <iostream>
-#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 #include <libvcdparser.h>
 
+#ifdef VCDPARSER_HAVE_ZLIB
+
+#include <gzip_source.h>
+
+#endif
+
 const char *getTimeUnitString(VcdFormat::TimeUnit unit) {
     switch (unit) {
         case VcdFormat::TimeUnit::unit_s:
@@ -24,39 +32,81 @@ const char *getTimeUnitString(VcdFormat::TimeUnit unit) {
     }
 }
 
-std::string readFile(const char *path) {
-    std::ifstream f(path);
-    if (!f.is_open()) {
-        std::cout << "Can't read " << path << std::endl;
-        exit(1);
+void printStats(const VcdParser::ParseStats &stats) {
+    std::cout << "Statistics:" << std::endl;
+    if (!VcdParser::ParseStats::Enabled) {
+        std::cout << "  not collected, the library was built without VCDPARSER_ENABLE_STATS" << std::endl;
+        return;
     }
-    std::string buffer;
-    f.seekg(0, std::ios::end);
-    size_t fileSize = f.tellg();
-    buffer.resize(fileSize);
-    f.seekg(0, std::ios::beg);
-    f.read(&buffer[0], fileSize);
-    return buffer;
+    std::cout << "  bytes: " << stats.bytes << std::endl;
+    std::cout << "  tokens: " << stats.tokens << std::endl;
+    std::cout << "  definitions section: " << stats.definitionsSeconds << " s" << std::endl;
+    std::cout << "  simulation section: " << stats.simulationSeconds << " s" << std::endl;
+    std::cout << "  time records: " << stats.timeRecords << std::endl;
+    std::cout << "  dump sections: " << stats.dumpSections << std::endl;
+    std::cout << "  scalar changes: " << stats.scalarChanges << std::endl;
+    std::cout << "  vector changes: " << stats.vectorChanges << std::endl;
+    std::cout << "  real changes: " << stats.realChanges << std::endl;
+    std::cout << "  skipped changes: " << stats.skippedChanges << std::endl;
+    std::cout << "  hashed identifier lookups: " << stats.hashedLookups << std::endl;
+    std::cout << "  identifier index: " << stats.identifierIndexBytes << " bytes" << std::endl;
+    std::cout << "  arena: " << stats.arenaBytes << " bytes" << std::endl;
+    std::cout << "  signal lists: " << stats.signalListBytes << " bytes" << std::endl;
+    std::cout << "  timestamps: " << stats.timestampBytes << " bytes" << std::endl;
 }
 
 int main(int argc, char **argv) {
-    if (argc <= 1) {
-        std::cout << "Usage: " << argv[0] << " vcd_file_path" << std::endl;
+    const char *path = nullptr;
+    bool showStats = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--stats") {
+            showStats = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == nullptr) {
+        std::cout << "Usage: " << argv[0] << " [--stats] vcd_file_path" << std::endl;
         return 1;
     }
 
-    std::string buffer = readFile(argv[1]);
+    VcdParser::VcdParser parser;
+    std::unique_ptr<VcdParser::MappedFile> file;
+    std::unique_ptr<VcdParser::StreamSource> stream;
+    try {
+        std::string name(path);
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0) {
+#ifdef VCDPARSER_HAVE_ZLIB
+            stream.reset(new VcdParser::GzipSource(name));
+#else
+            std::cout << "Can't read " << path << ": built without zlib" << std::endl;
+            return 1;
+#endif
+        } else {
+            file.reset(new VcdParser::MappedFile(path));
+            parser = VcdParser::VcdParser(*file);
+        }
+    } catch (const std::runtime_error &error) {
+        std::cout << "Can't read " << path << ": " << error.what() << std::endl;
+        return 1;
+    }
 
-    VcdParser::VcdParser parser(buffer);
     try {
-        parser.parse();
+        if (stream) {
+            parser.parseStream(*stream);
+        } else {
+            parser.parse();
+        }
     } catch (const VcdParser::VcdException &exception) {
         std::cout << "Parser error: (" << exception.line << ":" << exception.column << "): "
                   << exception.msg << std::endl;
         return 1;
+    } catch (const std::runtime_error &error) {
+        std::cout << "Can't read " << path << ": " << error.what() << std::endl;
+        return 1;
     }
 
-    std::cout << argv[1] << " has been parsed." << std::endl;
+    std::cout << path << " has been parsed." << std::endl;
 
     VcdFormat::VcdFile &result = parser.getResult();
 
@@ -66,13 +116,28 @@ int main(int argc, char **argv) {
               << getTimeUnitString(result.timescale.timeUnit) << std::endl;
     std::cout << "Last variable change time: " << result.lastVariableChangeTime << std::endl;
 
+    // variables holding their changes are listed in the order of their ids
+    uint32_t id = 0;
     for (auto it : result.variableList) {
         std::cout << "Variable:" << std::endl;
         std::cout << "  name: " << it->name << std::endl;
+        std::cout << "  scope: " << result.getPath(*it->scope) << std::endl;
         std::cout << "  identifier: " << it->identifier << std::endl;
-        std::cout << "  bus width: " << it->signalLists.size() << std::endl;
+        std::cout << "  bus width: " << it->width << std::endl;
+        if (it->aliasOf != nullptr) {
+            std::cout << "  alias of: " << result.getPath(*it->aliasOf) << std::endl;
+            continue;
+        }
+        if (showStats && VcdParser::ParseStats::Enabled) {
+            std::cout << "  changes: " << parser.getStats().variableChanges[id] << std::endl;
+        }
         for (const auto &it2 : it->signalLists) {
             std::cout << "    signal[" << it2.index << "]: data size=" << it2.values.size() << std::endl;
         }
+        id++;
+    }
+
+    if (showStats) {
+        printStats(parser.getStats());
     }
 }